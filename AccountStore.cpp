@@ -0,0 +1,122 @@
+#include "AccountStore.h"
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+
+using namespace std;
+
+// Compact once at least this many lines have been replaced, and they're at least half the file
+static const unsigned long long MIN_STALE_LINES_TO_COMPACT = 1000;
+
+bool AccountStore::isStorable(std::string_view text)
+{
+	return !text.empty() && text.find_first_of(" \t\r\n") == std::string_view::npos;
+}
+
+AccountStore::AccountStore()
+{
+	logLines = 0;
+}
+
+bool AccountStore::load(const std::string &theFileName)
+{
+	fileName = theFileName;
+	accounts.clear();
+	logLines = 0;
+
+	ifstream in(fileName);
+	string line;
+
+	while (getline(in, line))
+	{
+		istringstream fields(line);
+		string username;
+		string secret;
+
+		if (fields >> username >> secret)
+		{
+			accounts[username] = secret;
+			logLines++;
+		}
+	}
+	in.close();
+
+	compactIfNeeded();
+
+	if (log.is_open()) { log.close(); }
+	log.open(fileName, ios::app);
+
+	if (!log.good())
+	{
+		cerr << "Couldn't open " << fileName << " for writing, new accounts won't be saved" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool AccountStore::exists(std::string_view username) const
+{
+	return find(username) != NULL;
+}
+
+const std::string *AccountStore::find(std::string_view username) const
+{
+	unordered_map<string, string>::const_iterator it = accounts.find(string(username));
+	return it == accounts.end() ? NULL : &it->second;
+}
+
+bool AccountStore::set(std::string_view username, std::string_view secret)
+{
+	if (!isStorable(username) || !isStorable(secret)) { return false; }
+
+	accounts[string(username)] = string(secret);
+
+	if (log.is_open())
+	{
+		// Flushed straight away, so an account's never lost once the player's been told it was made
+		log << username << " " << secret << endl;
+		logLines++;
+	}
+
+	compactIfNeeded();
+	return true;
+}
+
+void AccountStore::compactIfNeeded()
+{
+	unsigned long long staleLines = logLines - accounts.size();
+
+	if (staleLines >= MIN_STALE_LINES_TO_COMPACT && staleLines * 2 >= logLines)
+	{
+		compact();
+	}
+}
+
+bool AccountStore::compact()
+{
+	string tempName = fileName + ".tmp";
+	{
+		ofstream out(tempName, ios::trunc);
+		if (!out.good()) { return false; }
+
+		for (unordered_map<string, string>::const_iterator it = accounts.begin(); it != accounts.end(); ++it)
+		{
+			out << it->first << " " << it->second << "\n";
+		}
+
+		if (!out.good()) { return false; }
+	}
+
+	bool wasOpen = log.is_open();
+	if (wasOpen) { log.close(); }
+
+	error_code error;
+	filesystem::rename(tempName, fileName, error);
+	bool renamed = !error;
+
+	if (renamed) { logLines = accounts.size(); }
+	if (wasOpen) { log.open(fileName, ios::app); }
+
+	return renamed;
+}
@@ -0,0 +1,51 @@
+#ifndef ACCOUNT_STORE_H
+#define ACCOUNT_STORE_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <fstream>
+
+// Every player account, read from data/userInfo.txt once at startup and kept in a hash map, so logging in or signing
+// up is a lookup rather than a read through the whole file.
+//
+// The file is an append-only log of "username secret" lines. New accounts (and changed secrets) are appended, and a
+// later line for a username replaces any earlier one. Once enough lines have been replaced the file's compacted,
+// i.e. rewritten with just the latest line for each account.
+class AccountStore
+{
+private:
+	std::string fileName;
+	std::unordered_map<std::string, std::string> accounts;   // Username -> secret
+	std::ofstream log;                                        // Kept open for appending to
+
+	unsigned long long logLines;      // Lines in the file, including the ones that have been replaced since
+
+	void compactIfNeeded();
+
+public:
+	AccountStore();
+
+	// Read every account in the file and open it for appending. Returns false if it couldn't be opened for writing
+	// (accounts still work, but new ones only last until the server stops)
+	bool load(const std::string &theFileName);
+
+	bool exists(std::string_view username) const;
+
+	// Whether a username or secret can go in the file (not empty, and no whitespace)
+	static bool isStorable(std::string_view text);
+
+	// The secret stored for a username, or NULL if there's no such account
+	const std::string *find(std::string_view username) const;
+
+	// Add an account, or replace the secret of an existing one. Returns false if the username or secret can't be
+	// stored (empty, or containing whitespace, which the file format can't hold)
+	bool set(std::string_view username, std::string_view secret);
+
+	unsigned int size() const { return (unsigned int)accounts.size(); }
+
+	// Rewrite the file with one line per account
+	bool compact();
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "AreaOfInterest.h"
+#include "Chunk.h"
+#include <cstdlib>
+
+// Remove one value from an unordered list by moving the last one into its place
+static void removeFromList(std::vector<unsigned int> &list, unsigned int value)
+{
+	for (unsigned int i = 0; i < list.size(); i++)
+	{
+		if (list[i] == value)
+		{
+			list[i] = list.back();
+			list.pop_back();
+			return;
+		}
+	}
+}
+
+void AreaOfInterest::growTo(unsigned int clientNumber)
+{
+	if (clientNumber < connected.size()) { return; }
+
+	connected.resize(clientNumber + 1, false);
+	placed.resize(clientNumber + 1, false);
+	clientChunkX.resize(clientNumber + 1, 0);
+	clientChunkY.resize(clientNumber + 1, 0);
+}
+
+void AreaOfInterest::takeOutOfChunk(unsigned int clientNumber)
+{
+	std::unordered_map<int64_t, std::vector<unsigned int>>::iterator chunk = chunkClients.find(chunkKey(clientChunkX[clientNumber], clientChunkY[clientNumber]));
+
+	if (chunk != chunkClients.end())
+	{
+		removeFromList(chunk->second, clientNumber);
+		if (chunk->second.empty()) { chunkClients.erase(chunk); }
+	}
+}
+
+void AreaOfInterest::addClient(unsigned int clientNumber)
+{
+	growTo(clientNumber);
+	if (connected[clientNumber]) { return; }
+
+	connected[clientNumber] = true;
+	placed[clientNumber] = false;
+	unplacedClients.push_back(clientNumber);
+}
+
+void AreaOfInterest::removeClient(unsigned int clientNumber)
+{
+	if (clientNumber >= connected.size() || !connected[clientNumber]) { return; }
+
+	if (placed[clientNumber])
+	{
+		takeOutOfChunk(clientNumber);
+	}
+	else
+	{
+		removeFromList(unplacedClients, clientNumber);
+	}
+
+	connected[clientNumber] = false;
+	placed[clientNumber] = false;
+}
+
+void AreaOfInterest::setClientPosition(unsigned int clientNumber, double x, double y)
+{
+	if (clientNumber >= connected.size() || !connected[clientNumber]) { return; }
+
+	int chunkX = chunkOf(x);
+	int chunkY = chunkOf(y);
+
+	if (placed[clientNumber])
+	{
+		// Nearly every update is from a ship that's still in the same chunk
+		if (chunkX == clientChunkX[clientNumber] && chunkY == clientChunkY[clientNumber]) { return; }
+
+		takeOutOfChunk(clientNumber);
+	}
+	else
+	{
+		removeFromList(unplacedClients, clientNumber);
+		placed[clientNumber] = true;
+	}
+
+	clientChunkX[clientNumber] = chunkX;
+	clientChunkY[clientNumber] = chunkY;
+	chunkClients[chunkKey(chunkX, chunkY)].push_back(clientNumber);
+}
+
+bool AreaOfInterest::isInterested(unsigned int clientNumber, int chunkX, int chunkY) const
+{
+	if (clientNumber >= connected.size() || !connected[clientNumber]) { return false; }
+	if (!placed[clientNumber]) { return true; }
+
+	return abs(clientChunkX[clientNumber] - chunkX) <= 1 && abs(clientChunkY[clientNumber] - chunkY) <= 1;
+}
+
+bool AreaOfInterest::getNearbyChunks(unsigned int clientNumber, int64_t keys[9]) const
+{
+	if (!isPlaced(clientNumber)) { return false; }
+
+	int count = 0;
+	for (int y = clientChunkY[clientNumber] - 1; y <= clientChunkY[clientNumber] + 1; y++)
+	{
+		for (int x = clientChunkX[clientNumber] - 1; x <= clientChunkX[clientNumber] + 1; x++)
+		{
+			keys[count++] = chunkKey(x, y);
+		}
+	}
+
+	return true;
+}
+
+bool AreaOfInterest::hasClientsNear(int chunkX, int chunkY) const
+{
+	for (int y = chunkY - 1; y <= chunkY + 1; y++)
+	{
+		for (int x = chunkX - 1; x <= chunkX + 1; x++)
+		{
+			if (chunkClients.count(chunkKey(x, y)) > 0) { return true; }
+		}
+	}
+
+	return false;
+}
+
+void AreaOfInterest::findInterested(int chunkX, int chunkY, std::vector<unsigned int> &clients) const
+{
+	clients.assign(unplacedClients.begin(), unplacedClients.end());
+
+	for (int y = chunkY - 1; y <= chunkY + 1; y++)
+	{
+		for (int x = chunkX - 1; x <= chunkX + 1; x++)
+		{
+			std::unordered_map<int64_t, std::vector<unsigned int>>::const_iterator chunk = chunkClients.find(chunkKey(x, y));
+
+			if (chunk != chunkClients.end())
+			{
+				clients.insert(clients.end(), chunk->second.begin(), chunk->second.end());
+			}
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef AREA_OF_INTEREST_H
+#define AREA_OF_INTEREST_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Keeps track of which chunk (see Chunk.h) each client's ship is in, so position and shot traffic only has to go
+// to the clients close enough to care: those in the same chunk or one of the eight around it.
+//
+// Clients that haven't told us where they are yet hear about everything, same as before this existed.
+class AreaOfInterest
+{
+private:
+	std::vector<bool> connected;
+	std::vector<bool> placed;           // Whether we know which chunk the client is in
+	std::vector<int> clientChunkX;
+	std::vector<int> clientChunkY;
+
+	// Clients in each chunk, and the clients who haven't been placed yet
+	std::unordered_map<int64_t, std::vector<unsigned int>> chunkClients;
+	std::vector<unsigned int> unplacedClients;
+
+	void growTo(unsigned int clientNumber);
+	void takeOutOfChunk(unsigned int clientNumber);
+
+public:
+	void addClient(unsigned int clientNumber);
+	void removeClient(unsigned int clientNumber);
+
+	// Record where the client's ship is, in world coordinates
+	void setClientPosition(unsigned int clientNumber, double x, double y);
+
+	bool isPlaced(unsigned int clientNumber) const { return clientNumber < placed.size() && placed[clientNumber]; }
+	int getChunkX(unsigned int clientNumber) const { return clientChunkX[clientNumber]; }
+	int getChunkY(unsigned int clientNumber) const { return clientChunkY[clientNumber]; }
+
+	// Whether a client should hear about something happening in the given chunk
+	bool isInterested(unsigned int clientNumber, int chunkX, int chunkY) const;
+
+	// Fill keys with the chunkKey()s of the nine chunks a client is interested in. Returns false (and leaves keys
+	// alone) if the client isn't placed yet, meaning they're interested in everywhere
+	bool getNearbyChunks(unsigned int clientNumber, int64_t keys[9]) const;
+
+	// Whether any placed client is in the given chunk or one of the eight around it
+	bool hasClientsNear(int chunkX, int chunkY) const;
+
+	// Every client that should hear about something happening in the given chunk (replaces what's in clients)
+	void findInterested(int chunkX, int chunkY, std::vector<unsigned int> &clients) const;
+};
+
+#endif
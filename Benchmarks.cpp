@@ -0,0 +1,620 @@
+#include "Benchmarks.h"
+#include "CommandDispatcher.h"
+#include "RegionSimulation.h"
+#include "CollisionWorld.h"
+#include "Chunk.h"
+#include "ChunkGenerator.h"
+#include "PasswordHash.h"
+#include "PasswordWorkers.h"
+#include "ServerSocket.h"
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef SERVER_USE_EPOLL
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <cstring>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Typical traffic: mostly shooting, with the odd chunk load and login mixed in
+static const char *SAMPLE_TRAFFIC[] = {
+	"!shoot:~user:riley~shot:blaster~xcor: 18450~ycor: 6012~rotat:135~xvshot:12~yvshot:-7~xcor: 18470~ycor: 6032~~",
+	"!shoot:~user:charlie~shot:blaster~xcor: -2210~ycor: 40112~rotat:270~xvshot:-3~yvshot:15~xcor: -2190~ycor: 40132~~",
+	"!shoot:~user:george~shot:blaster~xcor: 991~ycor: 3495~rotat:45~xvshot:8~yvshot:8~xcor: 1011~ycor: 3515~~",
+	"!loadchunk:0,0~",
+	"!loadchunk:-1,2~",
+	"!shoot:~user:shannon~shot:blaster~xcor: 15271~ycor: 12038~rotat:0~xvshot:20~yvshot:0~xcor: 15291~ycor: 12058~~",
+	"!logt:brandon/brandon~",
+	"!use:brandon",
+	"!signup:newpilot/hunter2~",
+};
+
+// What both parsers extract, so we can check they agree and the compiler can't throw the work away
+struct ParseTotals
+{
+	long long commands;
+	long long shots;
+	long long checksum;
+};
+
+//////////////////// the old parser, as it was in ServerSocket::dealWithActivity ////////////////////
+
+// delete everything up to and including the first ':'
+static void legacyStripToColon(string &bufferContents)
+{
+	bool foundPlayers = false;
+
+	while (foundPlayers == false) {
+		if (bufferContents[0] != ':') {
+			bufferContents.erase(bufferContents.begin() + 0);
+		}
+		else {
+			foundPlayers = true;
+			bufferContents.erase(bufferContents.begin());
+		}
+	}
+}
+
+// "a<separator>b~" -> first = "a", second = "b"
+static void legacySplitPair(const string &bufferContents, char separator, string &first, string &second)
+{
+	bool foundUser2 = false;
+	first = bufferContents;
+	bool holdv = false;
+	int usernameVariable = 0;
+
+	while (foundUser2 == false) {
+		if (holdv) {
+			if (first[usernameVariable] == '~') {
+				foundUser2 = true;
+			}
+			first.erase(first.begin() + usernameVariable);
+		}
+		else {
+			if (first[usernameVariable] == separator) {
+				first.erase(first.begin() + usernameVariable);
+				usernameVariable--;
+				holdv = true;
+			}
+			usernameVariable++;
+		}
+	}
+
+	bool foundPassword = false;
+	second = bufferContents;
+	bool holdvPass = false;
+	int passwordVariable = 0;
+
+	while (foundPassword == false) {
+		if (holdvPass == false) {
+			if (second[0] != separator) {
+				second.erase(second.begin() + 0);
+			}
+			else {
+				holdvPass = true;
+				second.erase(second.begin() + 0);
+			}
+		}
+		else {
+			if (second[passwordVariable] == '~') {
+				foundPassword = true;
+				second.erase(second.begin() + passwordVariable);
+			}
+			else {
+				passwordVariable++;
+			}
+		}
+	}
+}
+
+static void legacyParse(string bufferContents, ParseTotals &totals)
+{
+	//delete first character of string '!'
+	bufferContents.erase(bufferContents.begin());
+
+	if (bufferContents[0] == 'u' && bufferContents[1] == 's' && bufferContents[2] == 'e') {
+		legacyStripToColon(bufferContents);
+		totals.commands++;
+		totals.checksum += bufferContents.length();
+	}
+
+	if (bufferContents[0] == 's' && bufferContents[1] == 'h' && bufferContents[2] == 'o' && bufferContents[3] == 'o' && bufferContents[4] == 't') {
+
+		bufferContents.erase(bufferContents.begin(), bufferContents.begin() + 6);
+		vector<string> shootInfo;
+		int counting = 0;
+
+		while (bufferContents.length() > 2) {
+			counting = bufferContents.length() - 1;
+			bool tempBool = true;
+
+			bufferContents.erase(bufferContents.begin() + counting);
+			counting--;
+
+			while (tempBool) {
+				if (bufferContents[counting] != '~') {
+					counting--;
+				}
+				else {
+					tempBool = false;
+				}
+			}
+
+			shootInfo.push_back(bufferContents.substr(counting + 1, ((bufferContents.length() - 1) - counting + 1)));
+			bufferContents.erase(counting, ((bufferContents.length() - 1) - counting));
+		}
+
+		for (size_t i = 0; i < shootInfo.size(); i++) {
+			if (shootInfo[i][0] == 'u' && shootInfo[i][1] == 's' && shootInfo[i][2] == 'e' && shootInfo[i][3] == 'r') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 5);
+				totals.checksum += shootInfo[i].length();
+			}
+			if (shootInfo[i][0] == 's' && shootInfo[i][1] == 'h' && shootInfo[i][2] == 'o' && shootInfo[i][3] == 't') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 5);
+				totals.checksum += shootInfo[i].length();
+			}
+			if (shootInfo[i][0] == 'x' && shootInfo[i][1] == 'c' && shootInfo[i][2] == 'o' && shootInfo[i][3] == 'r') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 6);
+				totals.checksum += stoi(shootInfo[i]);
+				totals.shots++;
+			}
+			if (shootInfo[i][0] == 'y' && shootInfo[i][1] == 'c' && shootInfo[i][2] == 'o' && shootInfo[i][3] == 'r') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 6);
+				totals.checksum += stoi(shootInfo[i]);
+			}
+			if (shootInfo[i][0] == 'r' && shootInfo[i][1] == 'o' && shootInfo[i][2] == 't' && shootInfo[i][3] == 'a') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 6);
+				totals.checksum += stoi(shootInfo[i]);
+			}
+			if (shootInfo[i][0] == 'x' && shootInfo[i][1] == 'v' && shootInfo[i][2] == 's' && shootInfo[i][3] == 'h' && shootInfo[i][4] == 'o' && shootInfo[i][5] == 't') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 7);
+				totals.checksum += stoi(shootInfo[i]);
+			}
+			if (shootInfo[i][0] == 'y' && shootInfo[i][1] == 'v' && shootInfo[i][2] == 's' && shootInfo[i][3] == 'h' && shootInfo[i][4] == 'o' && shootInfo[i][5] == 't') {
+				shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 7);
+				totals.checksum += stoi(shootInfo[i]);
+			}
+		}
+		totals.commands++;
+	}
+
+	if (bufferContents[0] == 'l' && bufferContents[1] == 'o' && bufferContents[2] == 'a' && bufferContents[3] == 'd' && bufferContents[4] == 'c' && bufferContents[5] == 'h') {
+		legacyStripToColon(bufferContents);
+		string getChunkX;
+		string getChunkY;
+		legacySplitPair(bufferContents, ',', getChunkX, getChunkY);
+		totals.checksum += stoi(getChunkX) + stoi(getChunkY);
+		totals.commands++;
+	}
+
+	if ((bufferContents[0] == 'l' && bufferContents[1] == 'o' && bufferContents[2] == 'g' && bufferContents[3] == 't') ||
+		(bufferContents[0] == 's' && bufferContents[1] == 'i' && bufferContents[2] == 'g' && bufferContents[3] == 'n' && bufferContents[4] == 'u' && bufferContents[5] == 'p')) {
+		legacyStripToColon(bufferContents);
+		string attemptedUsername;
+		string attemptedPassword;
+		legacySplitPair(bufferContents, '/', attemptedUsername, attemptedPassword);
+		totals.checksum += attemptedUsername.length() + attemptedPassword.length();
+		totals.commands++;
+	}
+}
+
+//////////////////// the dispatcher, with handlers that parse the same way ServerSocket's do ////////////////////
+
+class ParserBenchTarget
+{
+public:
+	ParseTotals totals;
+
+	void handleUse(unsigned int, string_view args)
+	{
+		totals.commands++;
+		totals.checksum += args.length();
+	}
+
+	void handleShoot(unsigned int, string_view args)
+	{
+		ShootCommand shot;
+		if (!parseShootCommand(args, shot)) { return; }
+
+		totals.checksum += shot.user.length() + shot.type.length() + shot.rotation + shot.velocityX + shot.velocityY;
+		for (int i = 0; i < shot.numBarrels; i++)
+		{
+			totals.checksum += shot.x[i] + shot.y[i];
+		}
+		totals.shots += shot.numBarrels;
+		totals.commands++;
+	}
+
+	void handleLoadChunk(unsigned int, string_view args)
+	{
+		int chunkX;
+		int chunkY;
+		if (!parseChunkCommand(args, chunkX, chunkY)) { return; }
+
+		totals.checksum += chunkX + chunkY;
+		totals.commands++;
+	}
+
+	void handleCredentials(unsigned int, string_view args)
+	{
+		string_view username;
+		string_view password;
+		if (!parseCredentials(args, username, password)) { return; }
+
+		totals.checksum += username.length() + password.length();
+		totals.commands++;
+	}
+};
+
+int runParserBenchmark(const char *trafficFile)
+{
+	vector<string> traffic;
+
+	if (trafficFile != NULL)
+	{
+		ifstream in(trafficFile);
+		string line;
+		while (getline(in, line))
+		{
+			// Only commands go through the parser, everything else is just relayed
+			if (line.length() > 1 && line[0] == '!') { traffic.push_back(line); }
+		}
+
+		if (traffic.empty())
+		{
+			cerr << "No commands found in " << trafficFile << endl;
+			return 1;
+		}
+	}
+	else
+	{
+		for (unsigned int i = 0; i < sizeof(SAMPLE_TRAFFIC) / sizeof(SAMPLE_TRAFFIC[0]); i++)
+		{
+			traffic.push_back(SAMPLE_TRAFFIC[i]);
+		}
+	}
+
+	const int iterations = 200000 / (int)traffic.size() + 1;
+	const long long messages = (long long)iterations * traffic.size();
+
+	// Old parser
+	ParseTotals legacyTotals = { 0, 0, 0 };
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned int m = 0; m < traffic.size(); m++)
+		{
+			legacyParse(traffic[m], legacyTotals);
+		}
+	}
+	double legacySeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Dispatcher
+	CommandDispatcher<ParserBenchTarget> dispatcher;
+	dispatcher.add("use", &ParserBenchTarget::handleUse);
+	dispatcher.add("shoot", &ParserBenchTarget::handleShoot);
+	dispatcher.add("loadchunk", &ParserBenchTarget::handleLoadChunk);
+	dispatcher.add("logt", &ParserBenchTarget::handleCredentials);
+	dispatcher.add("signup", &ParserBenchTarget::handleCredentials);
+
+	ParserBenchTarget target;
+	target.totals.commands = 0;
+	target.totals.shots = 0;
+	target.totals.checksum = 0;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned int m = 0; m < traffic.size(); m++)
+		{
+			string_view message(traffic[m]);
+			dispatcher.dispatch(target, 0, message.substr(1));
+		}
+	}
+	double dispatcherSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "Parsed " << messages << " messages (" << traffic.size() << " distinct)" << endl;
+	cout << "  old parser:  " << (legacySeconds * 1e9 / messages) << " ns/message, "
+		<< legacyTotals.commands << " commands, " << legacyTotals.shots << " shots" << endl;
+	cout << "  dispatcher:  " << (dispatcherSeconds * 1e9 / messages) << " ns/message, "
+		<< target.totals.commands << " commands, " << target.totals.shots << " shots" << endl;
+	cout << "  speedup:     " << (legacySeconds / dispatcherSeconds) << "x" << endl;
+
+	if (legacyTotals.checksum != target.totals.checksum)
+	{
+		cout << "  warning: parsers disagree (checksum " << legacyTotals.checksum << " vs " << target.totals.checksum << ")" << endl;
+	}
+
+	return 0;
+}
+
+//////////////////// shot simulation ////////////////////
+
+static void spawnBenchShot(RegionSimulation &shots, uint8_t type, uint32_t owner)
+{
+	double x = (rand() % (3 * CHUNK_SIZE)) - CHUNK_SIZE;
+	double y = (rand() % (3 * CHUNK_SIZE)) - CHUNK_SIZE;
+	double velocityX = (rand() % 1441) - 720;
+	double velocityY = (rand() % 1441) - 720;
+
+	shots.spawn(type, owner, x, y, 0, velocityX, velocityY);
+}
+
+int runShotBenchmark(int numShots, int numThreads)
+{
+	if (numShots <= 0) { numShots = 5000; }
+	if (numThreads < 0) { numThreads = 0; }
+
+	const int numShips = 99;
+	const int ticks = 1000;
+	const double tickSeconds = 1.0 / 30;
+
+	srand(1);
+
+	RegionSimulation shots;
+	shots.start(numThreads);
+	uint8_t blaster = shots.registerType("blaster", 1.5);
+
+	// Ships and planets spread over chunks -1 to 1 in both directions, as if everyone were playing near the origin
+	CollisionWorld world;
+	for (int ship = 0; ship < numShips; ship++)
+	{
+		world.setShip(ship, ship, (rand() % (3 * CHUNK_SIZE)) - CHUNK_SIZE, (rand() % (3 * CHUNK_SIZE)) - CHUNK_SIZE);
+	}
+
+	for (int chunkX = -1; chunkX <= 1; chunkX++)
+	{
+		for (int chunkY = -1; chunkY <= 1; chunkY++)
+		{
+			for (int planet = 0; planet < 10; planet++)
+			{
+				world.addPlanet(chunkX, chunkY, planet, chunkX * CHUNK_SIZE + 500 + rand() % 19000, chunkY * CHUNK_SIZE + 500 + rand() % 19000, 300 + rand() % 1400);
+			}
+		}
+	}
+
+	for (int i = 0; i < numShots; i++)
+	{
+		spawnBenchShot(shots, blaster, i % numShips);
+	}
+
+	vector<ShotEvent> events;
+	long long hits = 0;
+	long long expired = 0;
+	double totalSeconds = 0;
+	double worstSeconds = 0;
+
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		events.clear();
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		shots.tick(tickSeconds, world, events);
+		for (unsigned int i = 0; i < events.size(); i++)
+		{
+			if (events[i].kind == SHOT_EXPIRED) { expired++; }
+			else { hits++; }
+		}
+
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		totalSeconds += seconds;
+		if (seconds > worstSeconds) { worstSeconds = seconds; }
+
+		// Top back up (not timed)
+		while (shots.size() < (unsigned int)numShots)
+		{
+			spawnBenchShot(shots, blaster, rand() % numShips);
+		}
+	}
+
+	cout << "Simulated " << ticks << " ticks of " << numShots << " shots against " << numShips << " ships and "
+		<< world.getPlanetCount() << " planets, on " << (numThreads + 1) << " thread(s)" << endl;
+	cout << "  per tick:  " << (totalSeconds * 1e3 / ticks) << " ms average, " << (worstSeconds * 1e3) << " ms worst" << endl;
+	cout << "  per shot:  " << (totalSeconds * 1e9 / ticks / numShots) << " ns" << endl;
+	cout << "  events:    " << hits << " hits, " << expired << " expired" << endl;
+	cout << "  handoffs:  " << shots.getHandoffCount() << " shots moved between regions" << endl;
+
+	return 0;
+}
+
+//////////////////// chunk generation ////////////////////
+
+int runChunkBenchmark(int planetsPerChunk, int planetSpacing)
+{
+	if (planetsPerChunk <= 0) { planetsPerChunk = 10; }
+	if (planetSpacing < 0) { planetSpacing = 2000; }
+
+	ChunkGenerator generator(1, planetsPerChunk, planetSpacing);
+	vector<Planet> planets;
+
+	const int chunksAcross = 40;
+	long long totalPlanets = 0;
+	double totalSeconds = 0;
+	double worstSeconds = 0;
+
+	for (int chunkY = 0; chunkY < chunksAcross; chunkY++)
+	{
+		for (int chunkX = 0; chunkX < chunksAcross; chunkX++)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			generator.generate(chunkX, chunkY, planets);
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			totalSeconds += seconds;
+			if (seconds > worstSeconds) { worstSeconds = seconds; }
+			totalPlanets += planets.size();
+		}
+	}
+
+	const int chunks = chunksAcross * chunksAcross;
+
+	cout << "Generated " << chunks << " chunks, asking for " << planetsPerChunk << " planets at least " << planetSpacing << " apart" << endl;
+	cout << "  per chunk:  " << (totalSeconds * 1e6 / chunks) << " us average, " << (worstSeconds * 1e6) << " us worst" << endl;
+	cout << "  planets:    " << ((double)totalPlanets / chunks) << " per chunk on average" << endl;
+
+	return 0;
+}
+
+int runLoginBenchmark(int cost, int numWorkers)
+{
+	if (cost <= 0) { cost = DEFAULT_PASSWORD_COST; }
+	if (numWorkers <= 0) { numWorkers = (int)max(1u, thread::hardware_concurrency()); }
+
+	if (cost < (int)MIN_PASSWORD_COST || cost > (int)MAX_PASSWORD_COST)
+	{
+		cerr << "Password cost has to be between " << MIN_PASSWORD_COST << " and " << MAX_PASSWORD_COST << endl;
+		return -1;
+	}
+
+	string stored = hashPassword("hunter2", cost);
+
+	// Enough logins to keep every worker busy for a while
+	const int logins = numWorkers * 8;
+
+	PasswordWorkers workers(cost, logins);
+	workers.start(numWorkers, NULL);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (int i = 0; i < logins; i++)
+	{
+		workers.submitLogin(i, "riley", "hunter2", stored);
+	}
+
+	int accepted = 0;
+	int done = 0;
+	vector<PasswordResult> results;
+
+	while (done < logins)
+	{
+		this_thread::sleep_for(chrono::milliseconds(1));
+
+		results.clear();
+		workers.takeFinished(results);
+
+		for (unsigned int i = 0; i < results.size(); i++)
+		{
+			if (results[i].accepted) { accepted++; }
+		}
+		done += (int)results.size();
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	workers.stop();
+
+	cout << logins << " logins at cost " << cost << " (" << ((128ull << cost) * 8 >> 20) << "MB each) on " << numWorkers << " workers" << endl;
+	cout << "  logins per second: " << (logins / seconds) << endl;
+	cout << "  per login:         " << (seconds * 1000 * numWorkers / logins) << " ms of worker time" << endl;
+	if (accepted != logins) { cout << "  " << (logins - accepted) << " logins failed!" << endl; }
+
+	return 0;
+}
+
+//////////////////// accepting connections ////////////////////
+
+#ifdef SERVER_USE_EPOLL
+
+// One client in the storm: connect, wait for the server's "OK" (or "FULL"), hang up, and go again until there are
+// no connections left to make
+static void acceptBenchClient(unsigned int port, atomic<int> &remaining, atomic<int> &accepted, atomic<int> &failed)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons((uint16_t)port);
+
+	while (remaining.fetch_sub(1) > 0)
+	{
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		char reply[16];
+
+		if (fd == -1 || connect(fd, (sockaddr *)&address, sizeof(address)) == -1 || recv(fd, reply, sizeof(reply), 0) <= 0)
+		{
+			failed++;
+		}
+		else if (reply[0] == 'O')
+		{
+			accepted++;
+		}
+		else
+		{
+			failed++;
+		}
+
+		if (fd != -1) { close(fd); }
+	}
+}
+
+int runAcceptBenchmark(int numConnections, int numAcceptors)
+{
+	if (numConnections <= 0) { numConnections = 20000; }
+	if (numAcceptors < 0) { numAcceptors = 0; }
+
+	const unsigned int port = 47123;
+	const int numClients = 64;
+
+	ServerSocket server(port, 512, 1001);
+	server.startAcceptors(numAcceptors);
+
+	atomic<int> remaining(numConnections);
+	atomic<int> accepted(0);
+	atomic<int> failed(0);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	// Everyone connects at once, as if the server had just come back up
+	vector<thread> clients;
+	for (int i = 0; i < numClients; i++)
+	{
+		clients.push_back(thread(acceptBenchClient, port, ref(remaining), ref(accepted), ref(failed)));
+	}
+
+	// The same network loop as main(), minus the ticks - the "OK"s go out with each flush
+	while (accepted + failed < numConnections)
+	{
+		server.checkForConnections(1);
+
+		int activeClient;
+		while ((activeClient = server.checkForActivity()) != -1)
+		{
+			server.dealWithActivity(activeClient);
+		}
+
+		server.flushClients();
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	for (unsigned int i = 0; i < clients.size(); i++)
+	{
+		clients[i].join();
+	}
+
+	cout << numConnections << " connections from " << numClients << " clients at once, " << numAcceptors << " acceptor thread(s)" << endl;
+	cout << "  connects per second: " << (numConnections / seconds) << endl;
+	if (failed > 0) { cout << "  " << failed << " connections failed or were turned away" << endl; }
+
+	return 0;
+}
+
+#else
+
+int runAcceptBenchmark(int numConnections, int numAcceptors)
+{
+	cerr << "--bench-accept needs the epoll build (Linux)" << endl;
+	return -1;
+}
+
+#endif
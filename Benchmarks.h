@@ -0,0 +1,34 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+// Microbenchmarks, run from the command line instead of starting the server, i.e.
+//   2D_GameEngine --bench-parser [traffic file]
+//   2D_GameEngine --bench-shots [number of shots] [simulation threads]
+//   2D_GameEngine --bench-chunks [planets per chunk] [planet spacing]
+//   2D_GameEngine --bench-login [password cost] [worker threads]
+//   2D_GameEngine --bench-accept [connections] [acceptor threads]
+
+// Compare the old character-by-character command parser with CommandParser/CommandDispatcher.
+// The traffic file has one client message per line (as captured from a running server); without one we use a
+// built-in sample of typical traffic
+int runParserBenchmark(const char *trafficFile);
+
+// Time one simulation tick of shots (RegionSimulation::tick, on numThreads threads besides the main one) with a full
+// server's worth of ships and a 3x3 block of loaded chunks. Shots that hit or expire are replaced so the count stays
+// steady
+int runShotBenchmark(int numShots, int numThreads);
+
+// Time generating chunks (ChunkGenerator::generate) - average and worst case per chunk, and how many of the planets
+// asked for actually fit
+int runChunkBenchmark(int planetsPerChunk, int planetSpacing);
+
+// Logins per second through a PasswordWorkers pool at the given scrypt cost (see PasswordHash.h), along with how long
+// a single login takes
+int runLoginBenchmark(int cost, int numWorkers);
+
+// Connections per second a server on port 47123 can take when lots of clients connect at once (each waits for the
+// "OK", hangs up and connects again), with connections accepted on the network thread or on numAcceptors acceptor
+// threads. Linux only
+int runAcceptBenchmark(int numConnections, int numAcceptors);
+
+#endif
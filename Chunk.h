@@ -0,0 +1,35 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <cstdint>
+#include <cmath>
+
+// The world is split into square chunks, each CHUNK_SIZE units across. Chunk (0,0) covers world coordinates
+// 0 to CHUNK_SIZE - 1 on both axes, and negative chunks run the other way.
+const int CHUNK_SIZE = 20000;
+
+// Furthest chunk from the middle in any direction, so every world coordinate in a chunk fits in an int
+const int MAX_CHUNK_COORDINATE = 2147483647 / CHUNK_SIZE - 1;
+
+inline bool isValidChunk(int chunkX, int chunkY)
+{
+	return chunkX >= -MAX_CHUNK_COORDINATE && chunkX <= MAX_CHUNK_COORDINATE && chunkY >= -MAX_CHUNK_COORDINATE && chunkY <= MAX_CHUNK_COORDINATE;
+}
+
+// Which chunk a world coordinate falls in (rounding down, so -1 is in chunk -1 rather than chunk 0)
+inline int chunkOf(double worldCoordinate)
+{
+	return (int)std::floor(worldCoordinate / CHUNK_SIZE);
+}
+
+// Pack a chunk's coordinates into one key, i.e. for hash maps
+inline int64_t chunkKey(int chunkX, int chunkY)
+{
+	return (int64_t)(((uint64_t)(uint32_t)chunkX << 32) | (uint32_t)chunkY);
+}
+
+// And back again
+inline int chunkKeyX(int64_t key) { return (int32_t)(key >> 32); }
+inline int chunkKeyY(int64_t key) { return (int32_t)(uint32_t)key; }
+
+#endif
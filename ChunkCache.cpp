@@ -0,0 +1,102 @@
+#include "ChunkCache.h"
+#include "Chunk.h"
+
+ChunkCache::ChunkCache(unsigned int theCapacity)
+{
+	capacity = theCapacity > 0 ? theCapacity : 1;
+	resetStats();
+}
+
+void ChunkCache::setCapacity(unsigned int theCapacity)
+{
+	capacity = theCapacity > 0 ? theCapacity : 1;
+
+	while (entries.size() > capacity)
+	{
+		index.erase(entries.back().key);
+		entries.pop_back();
+		evictions++;
+	}
+}
+
+SharedPayload ChunkCache::find(int chunkX, int chunkY)
+{
+	std::unordered_map<int64_t, std::list<Entry>::iterator>::iterator found = index.find(chunkKey(chunkX, chunkY));
+
+	if (found == index.end())
+	{
+		misses++;
+		return SharedPayload();
+	}
+
+	// Move it to the front, it's the most recently used now
+	entries.splice(entries.begin(), entries, found->second);
+
+	hits++;
+	return found->second->reply;
+}
+
+SharedPayload ChunkCache::peek(int chunkX, int chunkY)
+{
+	std::unordered_map<int64_t, std::list<Entry>::iterator>::iterator found = index.find(chunkKey(chunkX, chunkY));
+	if (found == index.end()) { return SharedPayload(); }
+
+	entries.splice(entries.begin(), entries, found->second);
+	return found->second->reply;
+}
+
+bool ChunkCache::contains(int chunkX, int chunkY) const
+{
+	return index.count(chunkKey(chunkX, chunkY)) > 0;
+}
+
+void ChunkCache::insert(int chunkX, int chunkY, const SharedPayload &reply)
+{
+	int64_t key = chunkKey(chunkX, chunkY);
+
+	std::unordered_map<int64_t, std::list<Entry>::iterator>::iterator found = index.find(key);
+	if (found != index.end())
+	{
+		found->second->reply = reply;
+		entries.splice(entries.begin(), entries, found->second);
+		return;
+	}
+
+	if (entries.size() >= capacity)
+	{
+		index.erase(entries.back().key);
+		entries.pop_back();
+		evictions++;
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.reply = reply;
+	entries.push_front(entry);
+	index[key] = entries.begin();
+}
+
+void ChunkCache::remove(int chunkX, int chunkY)
+{
+	std::unordered_map<int64_t, std::list<Entry>::iterator>::iterator found = index.find(chunkKey(chunkX, chunkY));
+	if (found == index.end()) { return; }
+
+	entries.erase(found->second);
+	index.erase(found);
+}
+
+void ChunkCache::printStats(std::ostream &out) const
+{
+	unsigned long long lookups = hits + misses;
+
+	out << "Chunk cache: " << entries.size() << "/" << capacity << " chunks, " << hits << " hits, " << misses << " misses";
+	if (lookups > 0) { out << " (" << (hits * 100 / lookups) << "% hit rate)"; }
+	out << ", " << evictions << " evicted" << std::endl;
+}
+
+void ChunkCache::resetStats()
+{
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+}
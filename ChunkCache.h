@@ -0,0 +1,59 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <ostream>
+#include <cstdint>
+#include "OutboundQueue.h"
+
+// Bounded cache of ready-to-send "retchunk" replies, keyed on chunk coordinates. When it's full the chunk that was
+// asked for least recently is thrown out. Replies are SharedPayloads, so a cache hit is a hash lookup and the reply
+// goes straight onto the client's queue without being copied.
+class ChunkCache
+{
+private:
+	struct Entry
+	{
+		int64_t key;
+		SharedPayload reply;
+	};
+
+	// Most recently used at the front
+	std::list<Entry> entries;
+	std::unordered_map<int64_t, std::list<Entry>::iterator> index;
+	unsigned int capacity;
+
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long evictions;
+
+public:
+	ChunkCache(unsigned int theCapacity);
+
+	// Change how many chunks are kept (evicting some straight away if there are too many)
+	void setCapacity(unsigned int theCapacity);
+
+	// The cached reply for a chunk, or an empty pointer if it isn't cached. Counts as a hit or a miss
+	SharedPayload find(int chunkX, int chunkY);
+
+	// Same as find(), but doesn't count towards the hit rate (i.e. for prefetching, so the stats only measure
+	// what clients actually asked for)
+	SharedPayload peek(int chunkX, int chunkY);
+
+	// Whether a chunk is cached, without counting as using it
+	bool contains(int chunkX, int chunkY) const;
+
+	// Add (or replace) a chunk's reply
+	void insert(int chunkX, int chunkY, const SharedPayload &reply);
+
+	// Forget a chunk (i.e. because it's changed)
+	void remove(int chunkX, int chunkY);
+
+	unsigned int size() const { return (unsigned int)entries.size(); }
+
+	void printStats(std::ostream &out) const;
+	void resetStats();
+};
+
+#endif
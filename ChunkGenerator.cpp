@@ -0,0 +1,130 @@
+#include "ChunkGenerator.h"
+#include "Chunk.h"
+#include <fstream>
+
+// Planet sizes
+static const int MIN_PLANET_DIAMETER = 300;
+static const int PLANET_DIAMETER_RANGE = 1400;
+static const int MAX_PLANET_DIAMETER = MIN_PLANET_DIAMETER + PLANET_DIAMETER_RANGE - 1;
+
+// Planets stay at least this far inside the edges of their chunk
+static const int CHUNK_MARGIN = 500;
+
+// Random positions we'll try per planet asked for before calling the chunk full
+static const int ATTEMPTS_PER_PLANET = 30;
+
+ChunkGenerator::ChunkGenerator(uint64_t theWorldSeed, unsigned int theNumPlanets, unsigned int thePlanetSpacing)
+{
+	worldSeed = theWorldSeed;
+	numPlanets = theNumPlanets;
+	planetSpacing = thePlanetSpacing;
+}
+
+void ChunkGenerator::generate(int chunkX, int chunkY, std::vector<Planet> &planets) const
+{
+	// Every chunk gets its own stream of numbers
+	ChunkRandom random(ChunkRandom::mix(worldSeed ^ ChunkRandom::mix((uint64_t)chunkKey(chunkX, chunkY))));
+
+	planets.clear();
+
+	// Chunks past MAX_CHUNK_COORDINATE would have planets outside the range of an int
+	if (!isValidChunk(chunkX, chunkY)) { return; }
+
+	const int area = CHUNK_SIZE - 2 * CHUNK_MARGIN;
+
+	// Throw darts at the chunk, keeping each one that's far enough from every planet so far. The chunk is split into
+	// a grid of cells as wide as the furthest apart two planets can be and still be too close, so a new planet only
+	// has to be checked against the planets in its own cell and the eight around it
+	const int cellSize = MAX_PLANET_DIAMETER + planetSpacing;
+	const int cellsAcross = area / cellSize + 1;
+
+	std::vector<int> cellFirst(cellsAcross * cellsAcross, -1);  // First planet in each cell, or -1
+	std::vector<int> nextInCell;                                 // Next planet in the same cell as each planet, or -1
+
+	// Local (within the chunk) positions and radii of the planets placed so far
+	std::vector<int> placedX;
+	std::vector<int> placedY;
+	std::vector<int> placedRadius;
+
+	const unsigned int maxAttempts = numPlanets * ATTEMPTS_PER_PLANET;
+
+	for (unsigned int attempt = 0; attempt < maxAttempts && planets.size() < numPlanets; attempt++)
+	{
+		int x = random.nextInt(area);
+		int y = random.nextInt(area);
+		int diameter = MIN_PLANET_DIAMETER + random.nextInt(PLANET_DIAMETER_RANGE);
+		int radius = diameter / 2;
+
+		int cellX = x / cellSize;
+		int cellY = y / cellSize;
+
+		bool clear = true;
+		for (int checkY = cellY - 1; checkY <= cellY + 1 && clear; checkY++)
+		{
+			for (int checkX = cellX - 1; checkX <= cellX + 1 && clear; checkX++)
+			{
+				if (checkX < 0 || checkY < 0 || checkX >= cellsAcross || checkY >= cellsAcross) { continue; }
+
+				for (int other = cellFirst[checkY * cellsAcross + checkX]; other != -1 && clear; other = nextInCell[other])
+				{
+					long long xSide = x - placedX[other];
+					long long ySide = y - placedY[other];
+					long long gap = radius + placedRadius[other] + planetSpacing;
+
+					clear = xSide * xSide + ySide * ySide >= gap * gap;
+				}
+			}
+		}
+
+		if (!clear) { continue; }
+
+		int cell = cellY * cellsAcross + cellX;
+		nextInCell.push_back(cellFirst[cell]);
+		cellFirst[cell] = (int)placedX.size();
+
+		placedX.push_back(x);
+		placedY.push_back(y);
+		placedRadius.push_back(radius);
+
+		Planet planet;
+		planet.x = CHUNK_SIZE * chunkX + CHUNK_MARGIN + x;
+		planet.y = CHUNK_SIZE * chunkY + CHUNK_MARGIN + y;
+		planet.diameter = diameter;
+		planet.r = random.nextInt(255);
+		planet.g = random.nextInt(255);
+		planet.b = random.nextInt(255);
+		planet.image = random.nextInt(30);
+
+		planets.push_back(planet);
+	}
+}
+
+bool readChunkFile(const std::string &fileName, std::vector<Planet> &planets)
+{
+	std::ifstream in(fileName);
+	if (!in.good()) { return false; }
+
+	planets.clear();
+
+	Planet planet;
+	while (in >> planet.x >> planet.y >> planet.diameter >> planet.r >> planet.g >> planet.b >> planet.image)
+	{
+		planets.push_back(planet);
+	}
+
+	return true;
+}
+
+bool writeChunkFile(const std::string &fileName, const std::vector<Planet> &planets)
+{
+	std::ofstream out(fileName);
+	if (!out.good()) { return false; }
+
+	for (unsigned int i = 0; i < planets.size(); i++)
+	{
+		out << planets[i].x << " " << planets[i].y << " " << planets[i].diameter << " " << planets[i].r << " "
+			<< planets[i].g << " " << planets[i].b << " " << planets[i].image << std::endl;
+	}
+
+	return out.good();
+}
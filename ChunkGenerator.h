@@ -0,0 +1,70 @@
+#ifndef CHUNK_GENERATOR_H
+#define CHUNK_GENERATOR_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// One planet, as stored in a chunk file line "x y diameter r g b image" (x and y are the middle of the planet)
+struct Planet
+{
+	int x;
+	int y;
+	int diameter;
+	int r;
+	int g;
+	int b;
+	int image;
+};
+
+// Counter-based random numbers: the n'th number of a stream is a hash of (stream key, n), so there's no hidden
+// state and a chunk's numbers come out the same whatever order chunks are generated in (unlike rand())
+class ChunkRandom
+{
+private:
+	uint64_t key;
+	uint64_t counter;
+
+public:
+	ChunkRandom(uint64_t theKey) : key(theKey), counter(0) {}
+
+	// SplitMix64's finaliser - a cheap hash that turns a counter into well mixed bits
+	static uint64_t mix(uint64_t value)
+	{
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	uint64_t next() { return mix(key + 0x9E3779B97F4A7C15ull * ++counter); }
+
+	// 0 to bound - 1
+	int nextInt(int bound) { return (int)(((next() >> 32) * (uint64_t)bound) >> 32); }
+};
+
+// Makes the planets for a chunk. The result depends only on the world seed and the chunk's coordinates, so chunks
+// don't need saving - any chunk can be made again, exactly the same, whenever it's needed.
+class ChunkGenerator
+{
+private:
+	uint64_t worldSeed;
+	unsigned int numPlanets;        // Planets we try to fit in each chunk
+	unsigned int planetSpacing;     // Smallest gap allowed between the edges of two planets
+
+public:
+	ChunkGenerator(uint64_t theWorldSeed, unsigned int theNumPlanets, unsigned int thePlanetSpacing);
+
+	void setWorldSeed(uint64_t theWorldSeed) { worldSeed = theWorldSeed; }
+	void setNumPlanets(unsigned int theNumPlanets) { numPlanets = theNumPlanets; }
+	void setPlanetSpacing(unsigned int thePlanetSpacing) { planetSpacing = thePlanetSpacing; }
+
+	// Replaces what's in planets with the chunk's planets. A crowded chunk (lots of planets, or a big spacing) can
+	// end up with fewer than numPlanets, rather than taking forever looking for room
+	void generate(int chunkX, int chunkY, std::vector<Planet> &planets) const;
+};
+
+// Chunks that have been changed from what the generator makes are saved as files (one planet per line)
+bool readChunkFile(const std::string &fileName, std::vector<Planet> &planets);
+bool writeChunkFile(const std::string &fileName, const std::vector<Planet> &planets);
+
+#endif
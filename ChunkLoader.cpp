@@ -0,0 +1,206 @@
+#include "ChunkLoader.h"
+#include "Chunk.h"
+#include <algorithm>
+
+using namespace std;
+
+ChunkLoader::ChunkLoader(uint64_t theWorldSeed, unsigned int theNumPlanets, unsigned int thePlanetSpacing)
+	: generator(theWorldSeed, theNumPlanets, thePlanetSpacing), regions("data/regions")
+{
+	stopping = false;
+	resetStats();
+}
+
+ChunkLoader::~ChunkLoader()
+{
+	stop();
+}
+
+void ChunkLoader::start(unsigned int numWorkers, std::function<void()> theOnFinished)
+{
+	onFinished = theOnFinished;
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(thread(&ChunkLoader::workerLoop, this));
+	}
+}
+
+void ChunkLoader::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	jobReady.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void ChunkLoader::workerLoop()
+{
+	while (true)
+	{
+		int64_t key;
+		{
+			unique_lock<mutex> guard(lock);
+			jobReady.wait(guard, [this] { return stopping || !jobs.empty(); });
+
+			if (stopping) { return; }
+
+			key = jobs.front();
+			jobs.pop_front();
+		}
+
+		LoadedChunk chunk;
+		load(chunkKeyX(key), chunkKeyY(key), chunk);
+
+		{
+			lock_guard<mutex> guard(lock);
+			finished.push_back(std::move(chunk));
+		}
+
+		if (onFinished) { onFinished(); }
+	}
+}
+
+bool ChunkLoader::request(int chunkX, int chunkY, unsigned int clientNumber)
+{
+	int64_t key = chunkKey(chunkX, chunkY);
+	requests++;
+
+	unordered_map<int64_t, vector<unsigned int>>::iterator it = waiting.find(key);
+	if (it != waiting.end())
+	{
+		// Already on its way - just wait for it too (once, however many times the client asks)
+		if (find(it->second.begin(), it->second.end(), clientNumber) == it->second.end())
+		{
+			it->second.push_back(clientNumber);
+		}
+		merged++;
+		return false;
+	}
+
+	waiting[key].push_back(clientNumber);
+	startLoad(chunkX, chunkY);
+
+	return true;
+}
+
+bool ChunkLoader::prefetch(int chunkX, int chunkY)
+{
+	int64_t key = chunkKey(chunkX, chunkY);
+	if (waiting.count(key) > 0) { return false; }
+
+	// Nobody's waiting on it, it just goes in the cache when it's done
+	waiting[key];
+	prefetched++;
+	startLoad(chunkX, chunkY);
+
+	return true;
+}
+
+void ChunkLoader::startLoad(int chunkX, int chunkY)
+{
+	loaded++;
+
+	if (workers.empty())
+	{
+		LoadedChunk chunk;
+		load(chunkX, chunkY, chunk);
+		finished.push_back(std::move(chunk));
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		jobs.push_back(chunkKey(chunkX, chunkY));
+	}
+	jobReady.notify_one();
+}
+
+void ChunkLoader::forgetClient(unsigned int clientNumber)
+{
+	// The load carries on regardless, the chunk still ends up in the cache for whoever wants it next
+	for (unordered_map<int64_t, vector<unsigned int>>::iterator it = waiting.begin(); it != waiting.end(); ++it)
+	{
+		it->second.erase(remove(it->second.begin(), it->second.end(), clientNumber), it->second.end());
+	}
+}
+
+void ChunkLoader::takeFinished(std::vector<LoadedChunk> &chunks)
+{
+	lock_guard<mutex> guard(lock);
+	chunks.swap(finished);
+}
+
+void ChunkLoader::takeWaiting(int chunkX, int chunkY, std::vector<unsigned int> &clients)
+{
+	clients.clear();
+
+	unordered_map<int64_t, vector<unsigned int>>::iterator it = waiting.find(chunkKey(chunkX, chunkY));
+	if (it == waiting.end()) { return; }
+
+	clients.swap(it->second);
+	waiting.erase(it);
+}
+
+void ChunkLoader::load(int chunkX, int chunkY, LoadedChunk &chunk)
+{
+	chunk.chunkX = chunkX;
+	chunk.chunkY = chunkY;
+	chunk.planets.clear();
+
+	const PlanetRecord *records;
+	unsigned int count;
+
+	if (regions.findChunk(chunkX, chunkY, records, count))
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Planet planet = { records[i].x, records[i].y, records[i].diameter, records[i].r, records[i].g, records[i].b, records[i].image };
+			chunk.planets.push_back(planet);
+		}
+	}
+	else
+	{
+		// Old style text saves still work until they're converted (see convertChunkFiles())
+		string chunkFile = "data/chunks/" + to_string(chunkX) + "," + to_string(chunkY) + "~.txt";
+
+		if (!readChunkFile(chunkFile, chunk.planets))
+		{
+			generator.generate(chunkX, chunkY, chunk.planets);
+		}
+	}
+
+	// "retchunk<x>~<y>~" then each planet's numbers, each followed by '~'
+	string chunkData = "retchunk" + to_string(chunkX) + "~" + to_string(chunkY) + "~";
+
+	for (unsigned int i = 0; i < chunk.planets.size(); i++)
+	{
+		const Planet &planet = chunk.planets[i];
+		chunkData += to_string(planet.x) + "~" + to_string(planet.y) + "~" + to_string(planet.diameter) + "~";
+		chunkData += to_string(planet.r) + "~" + to_string(planet.g) + "~" + to_string(planet.b) + "~";
+		chunkData += to_string(planet.image) + "~";
+	}
+
+	chunk.reply = makePayload(chunkData.c_str(), chunkData.length() + 1);
+}
+
+void ChunkLoader::printStats(std::ostream &out) const
+{
+	out << "Chunk loader: " << requests << " requests, " << loaded << " loaded, " << merged << " joined a load in progress, " << prefetched << " prefetched, "
+		<< waiting.size() << " in progress" << std::endl;
+}
+
+void ChunkLoader::resetStats()
+{
+	requests = 0;
+	merged = 0;
+	prefetched = 0;
+	loaded = 0;
+}
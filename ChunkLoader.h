@@ -0,0 +1,94 @@
+#ifndef CHUNK_LOADER_H
+#define CHUNK_LOADER_H
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <ostream>
+#include <cstdint>
+#include "ChunkGenerator.h"
+#include "RegionFile.h"
+#include "OutboundQueue.h"
+
+// A chunk that's finished loading, ready to go into the cache and out to whoever asked for it
+struct LoadedChunk
+{
+	int chunkX;
+	int chunkY;
+	std::vector<Planet> planets;
+	SharedPayload reply;
+};
+
+// Reads saved chunks and generates the rest on a pool of worker threads, so a cache miss never stalls the network
+// loop. The network thread calls request() and later takeFinished(); the workers only ever touch the job queue,
+// the finished list and their own copy of the planets, so nothing else needs locking.
+//
+// Lots of clients asking for the same chunk at once (i.e. everyone spawning in the same place) only loads it once -
+// requests for a chunk that's already on its way just add the client to the list waiting for it.
+class ChunkLoader
+{
+private:
+	ChunkGenerator generator;
+	RegionStore regions;                 // Saved chunks (the ones that have been changed from what the generator makes)
+
+	std::vector<std::thread> workers;
+	std::function<void()> onFinished;    // Called from a worker whenever it adds to finished (i.e. to wake the network loop)
+
+	std::mutex lock;                     // Guards jobs, finished and stopping
+	std::condition_variable jobReady;
+	std::deque<int64_t> jobs;            // Chunk keys waiting for a worker
+	std::vector<LoadedChunk> finished;   // Loaded chunks waiting for takeFinished()
+	bool stopping;
+
+	// Network thread only: chunks that have been asked for but not handed back yet, and the clients waiting on each
+	std::unordered_map<int64_t, std::vector<unsigned int>> waiting;
+
+	unsigned long long requests;
+	unsigned long long merged;           // Requests that joined a load that was already on its way
+	unsigned long long prefetched;       // Loads started by prefetch() rather than a client asking
+	unsigned long long loaded;
+
+	void workerLoop();
+	void startLoad(int chunkX, int chunkY);
+
+public:
+	ChunkLoader(uint64_t theWorldSeed, unsigned int theNumPlanets, unsigned int thePlanetSpacing);
+	~ChunkLoader();
+
+	// Only change these before start() - the workers read the generator without locking it
+	void setWorldSeed(uint64_t theWorldSeed) { generator.setWorldSeed(theWorldSeed); }
+	void setNumPlanets(unsigned int theNumPlanets) { generator.setNumPlanets(theNumPlanets); }
+	void setPlanetSpacing(unsigned int thePlanetSpacing) { generator.setPlanetSpacing(thePlanetSpacing); }
+
+	// Start the worker threads. With no workers, request() loads the chunk there and then instead
+	void start(unsigned int numWorkers, std::function<void()> theOnFinished);
+	void stop();
+
+	// Ask for a chunk on behalf of a client. Returns true if this started a new load (false if it joined one)
+	bool request(int chunkX, int chunkY, unsigned int clientNumber);
+
+	// Start loading a chunk nobody's asked for yet (unless it's already on its way). Returns true if it started a load
+	bool prefetch(int chunkX, int chunkY);
+
+	// A client's gone - don't hand it (or whoever gets its slot next) any chunks it was waiting for
+	void forgetClient(unsigned int clientNumber);
+
+	// Swaps everything that's finished loading into chunks (which should be empty)
+	void takeFinished(std::vector<LoadedChunk> &chunks);
+
+	// Swaps the clients waiting on a chunk into clients, and forgets the chunk was asked for
+	void takeWaiting(int chunkX, int chunkY, std::vector<unsigned int> &clients);
+
+	// Does the actual work for one chunk: the saved copy if there is one, otherwise the generator, and the
+	// "retchunk" reply for it. Safe to call from any thread
+	void load(int chunkX, int chunkY, LoadedChunk &chunk);
+
+	void printStats(std::ostream &out) const;
+	void resetStats();
+};
+
+#endif
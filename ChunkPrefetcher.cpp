@@ -0,0 +1,132 @@
+#include "ChunkPrefetcher.h"
+#include "Chunk.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// How much each new velocity sample counts for (the rest is the old velocity), so one jittery update doesn't send
+// the prediction off somewhere random
+static const double VELOCITY_SMOOTHING = 0.5;
+
+// Updates further apart than this are treated as a fresh start rather than movement (i.e. respawning)
+static const double MAX_SAMPLE_SECONDS = 1.0;
+
+// Updates closer together than this (about a tick) don't count as a new velocity sample. Several can arrive in one
+// read, microseconds apart, which would make the smallest move look impossibly fast
+static const double MIN_SAMPLE_SECONDS = 0.03;
+
+// Never look further ahead than this many chunks, however fast a client says it's going
+static const int MAX_LOOKAHEAD_CHUNKS = 3;
+
+ChunkPrefetcher::ChunkPrefetcher(double theLookaheadSeconds)
+{
+	lookaheadSeconds = theLookaheadSeconds;
+}
+
+// Keep a predicted coordinate inside the chunks that exist, so it's always safe to work out its chunk
+static double clampToWorld(double coordinate)
+{
+	const double lowest = -(double)MAX_CHUNK_COORDINATE * CHUNK_SIZE;
+	const double highest = ((double)MAX_CHUNK_COORDINATE + 1) * CHUNK_SIZE - 1;
+
+	return max(lowest, min(highest, coordinate));
+}
+
+void ChunkPrefetcher::removeClient(unsigned int clientNumber)
+{
+	if (clientNumber < tracks.size()) { tracks[clientNumber].placed = false; }
+}
+
+void ChunkPrefetcher::addNeighbourhood(int chunkX, int chunkY, std::vector<int64_t> &keys)
+{
+	for (int dy = -1; dy <= 1; dy++)
+	{
+		for (int dx = -1; dx <= 1; dx++)
+		{
+			if (!isValidChunk(chunkX + dx, chunkY + dy)) { continue; }
+
+			int64_t key = chunkKey(chunkX + dx, chunkY + dy);
+			if (find(keys.begin(), keys.end(), key) == keys.end()) { keys.push_back(key); }
+		}
+	}
+}
+
+bool ChunkPrefetcher::update(unsigned int clientNumber, double x, double y, std::vector<int64_t> &warm, std::vector<int64_t> &entered)
+{
+	if (clientNumber >= tracks.size())
+	{
+		Track unplaced = {};
+		tracks.resize(clientNumber + 1, unplaced);
+	}
+
+	Track &track = tracks[clientNumber];
+	Clock::time_point now = Clock::now();
+
+	bool wasPlaced = track.placed;
+	int oldChunkX = track.chunkX;
+	int oldChunkY = track.chunkY;
+	int oldAheadX = track.aheadChunkX;
+	int oldAheadY = track.aheadChunkY;
+
+	double elapsed = chrono::duration<double>(now - track.updated).count();
+
+	// Too soon after the last sample to tell anything from, so keep measuring from that one (the chunk we're in
+	// still gets updated below)
+	bool sample = !wasPlaced || elapsed >= MIN_SAMPLE_SECONDS;
+
+	if (wasPlaced && sample && elapsed < MAX_SAMPLE_SECONDS)
+	{
+		track.velocityX += ((x - track.x) / elapsed - track.velocityX) * VELOCITY_SMOOTHING;
+		track.velocityY += ((y - track.y) / elapsed - track.velocityY) * VELOCITY_SMOOTHING;
+	}
+	else if (sample)
+	{
+		track.velocityX = 0;
+		track.velocityY = 0;
+	}
+
+	if (sample)
+	{
+		track.x = x;
+		track.y = y;
+		track.updated = now;
+	}
+
+	track.placed = true;
+	track.chunkX = chunkOf(x);
+	track.chunkY = chunkOf(y);
+
+	int aheadX = chunkOf(clampToWorld(x + track.velocityX * lookaheadSeconds)) - track.chunkX;
+	int aheadY = chunkOf(clampToWorld(y + track.velocityY * lookaheadSeconds)) - track.chunkY;
+	track.aheadChunkX = track.chunkX + max(-MAX_LOOKAHEAD_CHUNKS, min(MAX_LOOKAHEAD_CHUNKS, aheadX));
+	track.aheadChunkY = track.chunkY + max(-MAX_LOOKAHEAD_CHUNKS, min(MAX_LOOKAHEAD_CHUNKS, aheadY));
+
+	bool moved = !wasPlaced || track.chunkX != oldChunkX || track.chunkY != oldChunkY;
+	bool headingSomewhereNew = track.aheadChunkX != oldAheadX || track.aheadChunkY != oldAheadY;
+
+	if (!moved && !headingSomewhereNew) { return false; }
+
+	warm.clear();
+	entered.clear();
+
+	addNeighbourhood(track.chunkX, track.chunkY, warm);
+	addNeighbourhood(track.aheadChunkX, track.aheadChunkY, warm);
+
+	if (moved)
+	{
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				int chunkX = track.chunkX + dx;
+				int chunkY = track.chunkY + dy;
+
+				bool wasNearby = wasPlaced && abs(chunkX - oldChunkX) <= 1 && abs(chunkY - oldChunkY) <= 1;
+				if (!wasNearby && isValidChunk(chunkX, chunkY)) { entered.push_back(chunkKey(chunkX, chunkY)); }
+			}
+		}
+	}
+
+	return true;
+}
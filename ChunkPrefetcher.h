@@ -0,0 +1,50 @@
+#ifndef CHUNK_PREFETCHER_H
+#define CHUNK_PREFETCHER_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+// Works out which chunks a client is going to ask for next, so they can be loaded before they're asked for.
+// Clients only send !loadchunk once they cross into a chunk, and a fast ship can get there before the chunk's loaded,
+// so every time a client moves into a new chunk (or is heading for a new one) we hand back:
+//   - the chunks around where it is, and around where it'll be in lookaheadSeconds at its current velocity, to warm
+//   - the chunks around where it is that weren't around where it was, which can be pushed to the client unasked
+class ChunkPrefetcher
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	struct Track
+	{
+		bool placed;
+		double x;               // Where it was at the last velocity sample
+		double y;
+		double velocityX;       // Units per second, smoothed over the last few position updates
+		double velocityY;
+		Clock::time_point updated;      // When the last velocity sample was
+		int chunkX;
+		int chunkY;
+		int aheadChunkX;        // The chunk we think it'll be in lookaheadSeconds from now
+		int aheadChunkY;
+	};
+
+	std::vector<Track> tracks;
+	double lookaheadSeconds;
+
+	static void addNeighbourhood(int chunkX, int chunkY, std::vector<int64_t> &keys);
+
+public:
+	ChunkPrefetcher(double theLookaheadSeconds);
+
+	void setLookaheadSeconds(double seconds) { lookaheadSeconds = seconds; }
+
+	void removeClient(unsigned int clientNumber);
+
+	// Record a client's position. Returns true if it means there are chunks to prefetch, in which case warm holds the
+	// chunkKey()s of the chunks to load and entered holds the ones the client's just come within range of
+	bool update(unsigned int clientNumber, double x, double y, std::vector<int64_t> &warm, std::vector<int64_t> &entered);
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "CollisionWorld.h"
+#include "Chunk.h"
+#include <algorithm>
+
+void CollisionWorld::setShip(unsigned int clientNumber, uint32_t playerId, double x, double y)
+{
+	if (clientNumber >= clientShip.size()) { clientShip.resize(clientNumber + 1, -1); }
+
+	int index = clientShip[clientNumber];
+
+	if (index == -1)
+	{
+		index = (int)shipX.size();
+		clientShip[clientNumber] = index;
+
+		shipX.push_back(x);
+		shipY.push_back(y);
+		shipPlayer.push_back(playerId);
+		shipClient.push_back(clientNumber);
+		return;
+	}
+
+	shipX[index] = x;
+	shipY[index] = y;
+	shipPlayer[index] = playerId;
+}
+
+void CollisionWorld::removeShip(unsigned int clientNumber)
+{
+	if (clientNumber >= clientShip.size() || clientShip[clientNumber] == -1) { return; }
+
+	int index = clientShip[clientNumber];
+	int last = (int)shipX.size() - 1;
+
+	// Swap the last ship into the hole
+	if (index != last)
+	{
+		shipX[index] = shipX[last];
+		shipY[index] = shipY[last];
+		shipPlayer[index] = shipPlayer[last];
+		shipClient[index] = shipClient[last];
+		clientShip[shipClient[index]] = index;
+	}
+
+	shipX.pop_back();
+	shipY.pop_back();
+	shipPlayer.pop_back();
+	shipClient.pop_back();
+	clientShip[clientNumber] = -1;
+}
+
+bool CollisionWorld::hasChunk(int chunkX, int chunkY) const
+{
+	return chunkPlanets.count(chunkKey(chunkX, chunkY)) > 0;
+}
+
+void CollisionWorld::addPlanet(int chunkX, int chunkY, uint32_t index, double x, double y, double diameter)
+{
+	ChunkPlanets &planets = chunkPlanets[chunkKey(chunkX, chunkY)];
+
+	unsigned int at = (unsigned int)(std::upper_bound(planets.x.begin(), planets.x.end(), x) - planets.x.begin());
+
+	planets.x.insert(planets.x.begin() + at, x);
+	planets.y.insert(planets.y.begin() + at, y);
+	planets.radius.insert(planets.radius.begin() + at, diameter / 2);
+	planets.index.insert(planets.index.begin() + at, index);
+	planetCount++;
+
+	if (diameter / 2 > largestPlanetRadius) { largestPlanetRadius = diameter / 2; }
+}
+
+void CollisionWorld::removeChunk(int chunkX, int chunkY)
+{
+	std::unordered_map<int64_t, ChunkPlanets>::iterator chunk = chunkPlanets.find(chunkKey(chunkX, chunkY));
+	if (chunk == chunkPlanets.end()) { return; }
+
+	planetCount -= (unsigned int)chunk->second.x.size();
+	chunkPlanets.erase(chunk);
+}
+
+void CollisionWorld::getChunks(std::vector<int64_t> &keys) const
+{
+	keys.clear();
+	for (std::unordered_map<int64_t, ChunkPlanets>::const_iterator chunk = chunkPlanets.begin(); chunk != chunkPlanets.end(); chunk++)
+	{
+		keys.push_back(chunk->first);
+	}
+}
+
+int CollisionWorld::findShipHit(double x, double y, uint32_t owner) const
+{
+	const double radiusSquared = SHIP_HIT_RADIUS * SHIP_HIT_RADIUS;
+
+	// Only ships within SHIP_HIT_RADIUS on x can be hit, and they're all together in the sorted list
+	unsigned int first = (unsigned int)(std::lower_bound(sortedShipX.begin(), sortedShipX.end(), x - SHIP_HIT_RADIUS) - sortedShipX.begin());
+
+	for (unsigned int i = first; i < sortedShipX.size() && sortedShipX[i] <= x + SHIP_HIT_RADIUS; i++)
+	{
+		unsigned int ship = sortedShips[i];
+		double dx = x - shipX[ship];
+		double dy = y - shipY[ship];
+
+		if (dx * dx + dy * dy < radiusSquared && shipPlayer[ship] != owner) { return (int)ship; }
+	}
+
+	return -1;
+}
+
+int CollisionWorld::findPlanetHit(double x, double y) const
+{
+	if (chunkPlanets.empty()) { return -1; }
+
+	// Planets are in the chunk their middle's in, so only chunks within the biggest radius of the shot can have
+	// one that reaches it (nearly always just the shot's own chunk)
+	int firstChunkX = chunkOf(x - largestPlanetRadius);
+	int lastChunkX = chunkOf(x + largestPlanetRadius);
+	int firstChunkY = chunkOf(y - largestPlanetRadius);
+	int lastChunkY = chunkOf(y + largestPlanetRadius);
+
+	for (int chunkY = firstChunkY; chunkY <= lastChunkY; chunkY++)
+	{
+		for (int chunkX = firstChunkX; chunkX <= lastChunkX; chunkX++)
+		{
+			std::unordered_map<int64_t, ChunkPlanets>::const_iterator chunk = chunkPlanets.find(chunkKey(chunkX, chunkY));
+			if (chunk == chunkPlanets.end()) { continue; }
+
+			const ChunkPlanets &planets = chunk->second;
+
+			// No planet further away on x than the biggest radius can be hit
+			unsigned int first = (unsigned int)(std::lower_bound(planets.x.begin(), planets.x.end(), x - largestPlanetRadius) - planets.x.begin());
+
+			for (unsigned int i = first; i < planets.x.size() && planets.x[i] <= x + largestPlanetRadius; i++)
+			{
+				double dx = x - planets.x[i];
+				double dy = y - planets.y[i];
+
+				if (dx * dx + dy * dy < planets.radius[i] * planets.radius[i]) { return (int)planets.index[i]; }
+			}
+		}
+	}
+
+	return -1;
+}
+
+void CollisionWorld::sortShips()
+{
+	const unsigned int shipCount = (unsigned int)shipX.size();
+
+	// Sort the ships by x once, so each shot only has to look at the few ships lined up with it rather than all of them
+	sortedShips.resize(shipCount);
+	for (unsigned int ship = 0; ship < shipCount; ship++) { sortedShips[ship] = ship; }
+
+	std::sort(sortedShips.begin(), sortedShips.end(), [this](unsigned int a, unsigned int b) { return shipX[a] < shipX[b]; });
+
+	sortedShipX.resize(shipCount);
+	for (unsigned int i = 0; i < shipCount; i++) { sortedShipX[i] = shipX[sortedShips[i]]; }
+}
+
+void CollisionWorld::findHits(const ShotStore &shots, std::vector<ShotEvent> &events) const
+{
+	const unsigned int shotCount = shots.size();
+	const unsigned int shipCount = (unsigned int)sortedShips.size();
+
+	const double *px = shots.getXArray();
+	const double *py = shots.getYArray();
+	const uint32_t *pOwner = shots.getOwnerArray();
+
+	for (unsigned int i = 0; i < shotCount; i++)
+	{
+		ShotEvent event;
+		event.shot = shots.getHandle(i);
+		event.id = shots.getId(i);
+		event.owner = pOwner[i];
+		event.x = px[i];
+		event.y = py[i];
+
+		int ship = shipCount > 0 ? findShipHit(px[i], py[i], pOwner[i]) : -1;
+		if (ship != -1)
+		{
+			event.kind = SHOT_HIT_SHIP;
+			event.target = shipPlayer[ship];
+			events.push_back(event);
+			continue;
+		}
+
+		int planet = findPlanetHit(px[i], py[i]);
+		if (planet != -1)
+		{
+			event.kind = SHOT_HIT_PLANET;
+			event.target = (uint32_t)planet;
+			events.push_back(event);
+		}
+	}
+}
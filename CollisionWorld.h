@@ -0,0 +1,74 @@
+#ifndef COLLISION_WORLD_H
+#define COLLISION_WORLD_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "ShotStore.h"
+
+// Ships are treated as circles this big for shots to hit
+const double SHIP_HIT_RADIUS = 50;
+
+// Everything a shot can run into: each client's ship (as last reported by the client) and the planets of the chunks
+// that are loaded. Ships are kept as packed arrays like ShotStore, sorted by x once a tick before the shots are
+// tested, so each shot only has to look at the few ships it lines up with. Planets are kept by chunk (each chunk's
+// sorted by x), so a shot only looks at the chunk it's in and any neighbour close enough for a planet to reach it.
+class CollisionWorld
+{
+private:
+	// Ships, packed (removing one moves the last into its place)
+	std::vector<double> shipX;
+	std::vector<double> shipY;
+	std::vector<uint32_t> shipPlayer;       // Interned id of the player flying it
+	std::vector<unsigned int> shipClient;   // Client slot it belongs to
+	std::vector<int> clientShip;            // Index into the ship arrays for each client slot, or -1
+
+	// One chunk's planets, sorted by x (a chunk only has a few, so inserting in order is cheap enough)
+	struct ChunkPlanets
+	{
+		std::vector<double> x;
+		std::vector<double> y;
+		std::vector<double> radius;
+		std::vector<uint32_t> index;        // Which planet it is within its chunk
+	};
+
+	std::unordered_map<int64_t, ChunkPlanets> chunkPlanets;    // By chunkKey
+	unsigned int planetCount = 0;
+	double largestPlanetRadius = 0;
+
+	// The ships sorted by x (by sortShips), kept between calls so it doesn't allocate every tick
+	std::vector<unsigned int> sortedShips;
+	std::vector<double> sortedShipX;
+
+	// Which ship (if any) a shot at x,y fired by owner has hit, or -1
+	int findShipHit(double x, double y, uint32_t owner) const;
+
+	// Which planet (if any) a shot at x,y has hit, or -1. The planet's index within its chunk, not an array index
+	int findPlanetHit(double x, double y) const;
+
+public:
+	// Where a client's ship is (and who's flying it)
+	void setShip(unsigned int clientNumber, uint32_t playerId, double x, double y);
+	void removeShip(unsigned int clientNumber);
+	unsigned int getShipCount() const { return (unsigned int)shipX.size(); }
+
+	// Planets for a chunk, from the chunk file's "x y diameter ..." lines (x and y are the middle of the planet).
+	// index is the planet's line number in the file, which is what hit events report
+	bool hasChunk(int chunkX, int chunkY) const;
+	void addPlanet(int chunkX, int chunkY, uint32_t index, double x, double y, double diameter);
+	unsigned int getPlanetCount() const { return planetCount; }
+
+	// Forget a chunk's planets (i.e. once it's unloaded), and list the chunks that have some (as chunkKeys)
+	void removeChunk(int chunkX, int chunkY);
+	void getChunks(std::vector<int64_t> &keys) const;
+
+	// Sort the ships by x for findHits. Call once ships have moved, before testing any shots against them
+	void sortShips();
+
+	// Test every shot against the ships and planets, adding a SHOT_HIT_SHIP or SHOT_HIT_PLANET event for each one
+	// that hit something. Shots never hit the ship of the player who fired them. Doesn't remove anything, and doesn't
+	// change the world either, so several threads can test their own ShotStores at once
+	void findHits(const ShotStore &shots, std::vector<ShotEvent> &events) const;
+};
+
+#endif
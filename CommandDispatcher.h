@@ -0,0 +1,55 @@
+#ifndef COMMAND_DISPATCHER_H
+#define COMMAND_DISPATCHER_H
+
+#include <string_view>
+#include <vector>
+#include "CommandParser.h"
+
+// Table of "!command" handlers, keyed on the command token (see splitCommand).
+// Handlers are member functions of Target, called with the client number and the command's arguments.
+template<class Target>
+class CommandDispatcher
+{
+public:
+	typedef void (Target::*Handler)(unsigned int clientNumber, std::string_view args);
+
+private:
+	struct Entry
+	{
+		std::string_view token;
+		Handler handler;
+	};
+
+	std::vector<Entry> entries;  // Only a handful of commands, so a straight search beats hashing
+
+public:
+	// Tokens must be string literals (or otherwise outlive the dispatcher)
+	void add(std::string_view token, Handler handler)
+	{
+		Entry entry;
+		entry.token = token;
+		entry.handler = handler;
+		entries.push_back(entry);
+	}
+
+	// Call the handler for a command message (without the leading '!'). Returns false if nobody handles it
+	bool dispatch(Target &target, unsigned int clientNumber, std::string_view message)
+	{
+		std::string_view token;
+		std::string_view args;
+		splitCommand(message, token, args);
+
+		for (unsigned int i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].token == token)
+			{
+				(target.*(entries[i].handler))(clientNumber, args);
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
+
+#endif
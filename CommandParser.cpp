@@ -0,0 +1,167 @@
+#include "CommandParser.h"
+#include <charconv>
+
+using std::string_view;
+
+void splitCommand(string_view message, string_view &token, string_view &args)
+{
+	size_t end = message.find_first_of(":~");
+
+	if (end == string_view::npos)
+	{
+		token = message;
+		args = string_view();
+	}
+	else
+	{
+		token = message.substr(0, end);
+		args = message[end] == ':' ? message.substr(end + 1) : message.substr(end);
+	}
+}
+
+bool parseInt(string_view text, int &value)
+{
+	while (!text.empty() && (text[0] == ' ' || text[0] == '+'))
+	{
+		text.remove_prefix(1);
+	}
+
+	std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr != text.data();
+}
+
+bool parseUint32(string_view text, uint32_t &value)
+{
+	while (!text.empty() && (text[0] == ' ' || text[0] == '+'))
+	{
+		text.remove_prefix(1);
+	}
+
+	std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc() && result.ptr != text.data();
+}
+
+bool FieldReader::next(string_view &field)
+{
+	while (!remaining.empty())
+	{
+		size_t end = remaining.find('~');
+
+		if (end == string_view::npos)
+		{
+			field = remaining;
+			remaining = string_view();
+		}
+		else
+		{
+			field = remaining.substr(0, end);
+			remaining.remove_prefix(end + 1);
+		}
+
+		if (!field.empty()) { return true; }
+	}
+
+	return false;
+}
+
+// If field starts with "key:" put what's after the colon in value
+static bool fieldValue(string_view field, string_view key, string_view &value)
+{
+	if (field.size() <= key.size() || field.compare(0, key.size(), key) != 0 || field[key.size()] != ':')
+	{
+		return false;
+	}
+
+	value = field.substr(key.size() + 1);
+	return true;
+}
+
+bool parseShootCommand(string_view args, ShootCommand &command)
+{
+	command.user = string_view();
+	command.type = string_view();
+	command.rotation = 0;
+	command.velocityX = 0;
+	command.velocityY = 0;
+	command.numBarrels = 0;
+
+	int numX = 0;
+	int numY = 0;
+
+	FieldReader fields(args);
+	string_view field;
+	string_view value;
+
+	while (fields.next(field))
+	{
+		// Switch on the first character so each field is only compared against the key it could be
+		switch (field[0])
+		{
+		case 'u':
+			if (fieldValue(field, "user", value)) { command.user = value; }
+			break;
+		case 's':
+			if (fieldValue(field, "shot", value)) { command.type = value; }
+			break;
+		case 'r':
+			if (fieldValue(field, "rotat", value)) { parseInt(value, command.rotation); }
+			break;
+		case 'x':
+			if (fieldValue(field, "xvshot", value)) { parseInt(value, command.velocityX); }
+			// Coordinates carry one extra character after the colon, which the server has always skipped
+			else if (fieldValue(field, "xcor", value) && numX < MAX_SHOT_BARRELS && !value.empty())
+			{
+				if (parseInt(value.substr(1), command.x[numX])) { numX++; }
+			}
+			break;
+		case 'y':
+			if (fieldValue(field, "yvshot", value)) { parseInt(value, command.velocityY); }
+			else if (fieldValue(field, "ycor", value) && numY < MAX_SHOT_BARRELS && !value.empty())
+			{
+				if (parseInt(value.substr(1), command.y[numY])) { numY++; }
+			}
+			break;
+		}
+	}
+
+	// One shot per complete xcor/ycor pair
+	command.numBarrels = numX < numY ? numX : numY;
+
+	return !command.user.empty() && !command.type.empty() && command.numBarrels > 0;
+}
+
+bool parseChunkCommand(string_view args, int &chunkX, int &chunkY)
+{
+	size_t comma = args.find(',');
+	if (comma == string_view::npos) { return false; }
+
+	size_t end = args.find('~', comma);
+	if (end == string_view::npos) { return false; }
+
+	return parseInt(args.substr(0, comma), chunkX) && parseInt(args.substr(comma + 1, end - comma - 1), chunkY);
+}
+
+bool parsePositionCommand(string_view args, int &x, int &y)
+{
+	size_t first = args.find('~');
+	if (first == string_view::npos) { return false; }
+
+	size_t second = args.find('~', first + 1);
+	if (second == string_view::npos) { return false; }
+
+	return parseInt(args.substr(0, first), x) && parseInt(args.substr(first + 1, second - first - 1), y);
+}
+
+bool parseCredentials(string_view args, string_view &username, string_view &password)
+{
+	size_t slash = args.find('/');
+	if (slash == string_view::npos) { return false; }
+
+	size_t end = args.find('~', slash);
+	if (end == string_view::npos) { return false; }
+
+	username = args.substr(0, slash);
+	password = args.substr(slash + 1, end - slash - 1);
+
+	return !username.empty();
+}
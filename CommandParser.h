@@ -0,0 +1,63 @@
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <string_view>
+#include <cstdint>
+
+// Parsing for the "!command:args" messages clients send to the server.
+//
+// Everything here works on std::string_view over the caller's buffer (normally straight into the client's receive
+// buffer), so nothing is copied and nothing is allocated. Views handed back are only valid for as long as the
+// buffer they point into.
+
+// Split "!command:args" (without the '!') into the command token and its arguments.
+// The token runs up to the first ':' or '~', i.e. "loadchunk:1,2~" gives "loadchunk" and "1,2~", "frame~" gives "frame"
+void splitCommand(std::string_view message, std::string_view &token, std::string_view &args);
+
+// Parse a (possibly signed) decimal integer, ignoring any leading spaces or '+'. Returns false if there's no number
+bool parseInt(std::string_view text, int &value);
+
+// Same for an unsigned 32 bit number (i.e. a sequence number, which can be anywhere up to 4294967295)
+bool parseUint32(std::string_view text, uint32_t &value);
+
+// Walks through a '~' separated list of fields, skipping empty ones
+class FieldReader
+{
+private:
+	std::string_view remaining;
+
+public:
+	FieldReader(std::string_view text) : remaining(text) {}
+
+	bool next(std::string_view &field);
+};
+
+// Most guns fire two shots at once, but leave room for bigger ones
+const int MAX_SHOT_BARRELS = 8;
+
+// "shoot:~user:<name>~shot:<type>~xcor:<x>~ycor:<y>~rotat:<r>~xvshot:<vx>~yvshot:<vy>~..." - one xcor/ycor pair per barrel
+struct ShootCommand
+{
+	std::string_view user;          // Who the client says fired it - not to be trusted, the server knows who sent it
+	std::string_view type;
+	int rotation;
+	int velocityX;
+	int velocityY;
+
+	int numBarrels;
+	int x[MAX_SHOT_BARRELS];
+	int y[MAX_SHOT_BARRELS];
+};
+
+bool parseShootCommand(std::string_view args, ShootCommand &command);
+
+// "loadchunk:<x>,<y>~"
+bool parseChunkCommand(std::string_view args, int &chunkX, int &chunkY);
+
+// "pos:<x>~<y>~" - where the client's ship is
+bool parsePositionCommand(std::string_view args, int &x, int &y);
+
+// "logt:<username>/<password>~" and "signup:<username>/<password>~"
+bool parseCredentials(std::string_view args, std::string_view &username, std::string_view &password);
+
+#endif
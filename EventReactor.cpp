@@ -0,0 +1,698 @@
+#include "EventReactor.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#ifdef SERVER_USE_EPOLL
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <chrono>
+#endif
+
+using namespace std;
+
+#ifdef SERVER_USE_EPOLL
+
+// Token stored in the epoll event data for the listening socket (client sockets store their slot number)
+static const uint32_t LISTENER_TOKEN = 0xFFFFFFFF;
+static const uint32_t WAKE_TOKEN = 0xFFFFFFFE;
+static const uint32_t UDP_TOKEN = 0xFFFFFFFD;
+
+// Helper to build an exception message from errno
+static SocketException systemError(const string &what)
+{
+	return SocketException(what + ": " + strerror(errno));
+}
+
+// Open a non-blocking socket listening on the port. With reusePort several of them can share the port (SO_REUSEPORT),
+// each with its own backlog
+static int openListenSocket(unsigned int port, bool reusePort)
+{
+	int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1)
+	{
+		throw systemError("Failed to open the server socket");
+	}
+
+	// Let us restart the server straight away without waiting for TIME_WAIT sockets to clear
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (reusePort) { setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)); }
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons((uint16_t)port);
+
+	if (bind(fd, (sockaddr *)&address, sizeof(address)) == -1 || listen(fd, SOMAXCONN) == -1)
+	{
+		SocketException e = systemError("Failed to open the server socket");
+		close(fd);
+		throw e;
+	}
+
+	return fd;
+}
+
+// Game traffic is lots of small messages, so don't let Nagle hold them back
+static void setNoDelay(int client)
+{
+	int on = 1;
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+EventReactor::EventReactor(unsigned int thePort, unsigned int theMaxSockets)
+{
+	port = thePort;
+	maxSockets = theMaxSockets;
+	listenerReady = false;
+	udpReady = false;
+	stopAcceptorsFd = -1;
+	udpFd = -1;
+
+	// Every client needs a descriptor, and the usual default limit (1024) is less than a big server's worth, so go as
+	// high as we're allowed to (with a few to spare for files, the epoll instance and so on)
+	rlimit limit;
+	rlim_t wanted = (rlim_t)maxSockets + 64;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < wanted)
+	{
+		limit.rlim_cur = limit.rlim_max < wanted ? limit.rlim_max : wanted;
+		setrlimit(RLIMIT_NOFILE, &limit);
+
+		if (limit.rlim_cur < wanted)
+		{
+			cerr << "Only allowed " << limit.rlim_cur << " open files, which isn't enough for " << (maxSockets - 1) << " clients" << endl;
+		}
+	}
+
+	// Not SO_REUSEPORT unless we're asked for acceptor threads, so starting a second server on the same port fails
+	// rather than quietly splitting the players between the two
+	listenFd = openListenSocket(port, false);
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd == -1)
+	{
+		SocketException e = systemError("Failed to create the epoll instance");
+		close(listenFd);
+		throw e;
+	}
+
+	epoll_event listenEvent;
+	listenEvent.events = EPOLLIN | EPOLLET;
+	listenEvent.data.u32 = LISTENER_TOKEN;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent);
+
+	// Other threads poke this to get us out of epoll_wait early (see wake())
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeFd == -1)
+	{
+		SocketException e = systemError("Failed to create the wakeup eventfd");
+		close(epollFd);
+		close(listenFd);
+		throw e;
+	}
+
+	epoll_event wakeEvent;
+	wakeEvent.events = EPOLLIN;
+	wakeEvent.data.u32 = WAKE_TOKEN;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wakeEvent);
+
+	events.resize(maxSockets + 1);
+}
+
+EventReactor::~EventReactor()
+{
+	if (!acceptors.empty())
+	{
+		uint64_t one = 1;
+		ssize_t written = write(stopAcceptorsFd, &one, sizeof(one));
+		(void)written;
+
+		for (unsigned int i = 0; i < acceptors.size(); i++)
+		{
+			acceptors[i].join();
+		}
+
+		for (unsigned int i = 0; i < acceptorFds.size(); i++)
+		{
+			close(acceptorFds[i]);
+		}
+
+		// Anyone accepted but never picked up
+		int client;
+		while (acceptedClients.pop(client)) { close(client); }
+	}
+
+	if (stopAcceptorsFd != -1) { close(stopAcceptorsFd); }
+	if (udpFd != -1) { close(udpFd); }
+	close(wakeFd);
+	close(epollFd);
+	close(listenFd);
+}
+
+void EventReactor::wake()
+{
+	uint64_t one = 1;
+	ssize_t written = write(wakeFd, &one, sizeof(one));
+	(void)written; // If the counter's already non-zero we're getting woken anyway
+}
+
+int EventReactor::wait(int timeoutMs)
+{
+	listenerReady = false;
+	udpReady = false;
+	readySlots.clear();
+
+	int numEvents = epoll_wait(epollFd, &events[0], (int)events.size(), timeoutMs);
+
+	// Being interrupted by a signal is not an error, it's just a wakeup with nothing to do
+	if (numEvents == -1)
+	{
+		if (errno == EINTR) { return 0; }
+		throw systemError("epoll_wait failed");
+	}
+
+	for (int i = 0; i < numEvents; i++)
+	{
+		if (events[i].data.u32 == LISTENER_TOKEN)
+		{
+			listenerReady = true;
+		}
+		else if (events[i].data.u32 == UDP_TOKEN)
+		{
+			udpReady = true;
+		}
+		else if (events[i].data.u32 == WAKE_TOKEN)
+		{
+			// Reset the counter, whoever woke us is dealt with by the caller
+			uint64_t count;
+			ssize_t readBytes = read(wakeFd, &count, sizeof(count));
+			(void)readBytes;
+
+			// It might be an acceptor with new connections for us
+			if (!acceptors.empty()) { listenerReady = true; }
+		}
+		else
+		{
+			// Hangups and errors are reported as readable too, the following receive() will pick up the close
+			readySlots.push_back((int)events[i].data.u32);
+		}
+	}
+
+	return numEvents;
+}
+
+ClientHandle EventReactor::acceptClient()
+{
+	// The acceptor threads have already accepted them, we just pick them up
+	if (!acceptors.empty())
+	{
+		int accepted;
+		if (acceptedClients.pop(accepted)) { return accepted; }
+
+		listenerReady = false;
+		return NO_CLIENT;
+	}
+
+	int client = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+	if (client == -1)
+	{
+		// Either the backlog is drained (EAGAIN) or the connection died before we got to it - either way there's
+		// nothing to hand back. Any other error is left for the next readiness event.
+		listenerReady = false;
+		return NO_CLIENT;
+	}
+
+	setNoDelay(client);
+
+	return client;
+}
+
+bool EventReactor::openUdp()
+{
+	if (udpFd != -1) { return true; }
+
+	udpFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (udpFd == -1) { return false; }
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons((uint16_t)port);
+
+	if (bind(udpFd, (sockaddr *)&address, sizeof(address)) == -1)
+	{
+		close(udpFd);
+		udpFd = -1;
+		return false;
+	}
+
+	epoll_event udpEvent;
+	udpEvent.events = EPOLLIN | EPOLLET;
+	udpEvent.data.u32 = UDP_TOKEN;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, udpFd, &udpEvent);
+
+	return true;
+}
+
+int EventReactor::receiveDatagram(char *buffer, int length, UdpAddress &from)
+{
+	while (true)
+	{
+		sockaddr_in address;
+		socklen_t addressLength = sizeof(address);
+		ssize_t received = recvfrom(udpFd, buffer, length, 0, (sockaddr *)&address, &addressLength);
+
+		if (received >= 0)
+		{
+			from.host = address.sin_addr.s_addr;
+			from.port = address.sin_port;
+			return (int)received;
+		}
+		if (errno == EINTR) { continue; }
+
+		// Drained (edge-triggered, so nothing more until the next readiness event)
+		udpReady = false;
+		return -1;
+	}
+}
+
+bool EventReactor::sendDatagram(const UdpAddress &to, const char *data, int length)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = to.host;
+	address.sin_port = to.port;
+
+	return sendto(udpFd, data, length, MSG_NOSIGNAL | MSG_DONTWAIT, (sockaddr *)&address, sizeof(address)) == length;
+}
+
+bool EventReactor::startAcceptors(unsigned int numAcceptors)
+{
+	if (numAcceptors == 0 || !acceptors.empty()) { return true; }
+
+	// Every socket sharing the port needs SO_REUSEPORT from the start, so swap the listener for one that has it
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, NULL);
+	close(listenFd);
+	listenFd = openListenSocket(port, true);
+
+	for (unsigned int i = 1; i < numAcceptors; i++)
+	{
+		acceptorFds.push_back(openListenSocket(port, true));
+	}
+
+	stopAcceptorsFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (stopAcceptorsFd == -1)
+	{
+		throw systemError("Failed to create the acceptor eventfd");
+	}
+
+	acceptors.push_back(thread(&EventReactor::acceptorLoop, this, listenFd));
+	for (unsigned int i = 0; i < acceptorFds.size(); i++)
+	{
+		acceptors.push_back(thread(&EventReactor::acceptorLoop, this, acceptorFds[i]));
+	}
+
+	return true;
+}
+
+// One acceptor thread: sleep until there are connections on our listener, take every one of them, then wake the
+// network thread to pick them up
+void EventReactor::acceptorLoop(int fd)
+{
+	pollfd waitFor[2];
+	waitFor[0].fd = fd;
+	waitFor[0].events = POLLIN;
+	waitFor[1].fd = stopAcceptorsFd;
+	waitFor[1].events = POLLIN;
+
+	while (true)
+	{
+		if (poll(waitFor, 2, -1) == -1)
+		{
+			if (errno == EINTR) { continue; }
+			return;
+		}
+
+		if (waitFor[1].revents != 0) { return; }
+
+		bool acceptedAny = false;
+
+		while (true)
+		{
+			int client = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+			if (client == -1)
+			{
+				if (errno == EINTR || errno == ECONNABORTED) { continue; }
+
+				// Out of descriptors - back off for a moment rather than spinning on a listener that stays readable
+				if (errno == EMFILE || errno == ENFILE) { this_thread::sleep_for(chrono::milliseconds(10)); }
+				break;
+			}
+
+			setNoDelay(client);
+			acceptedClients.push(client);
+			acceptedAny = true;
+		}
+
+		if (acceptedAny) { wake(); }
+	}
+}
+
+void EventReactor::addClient(ClientHandle client, int slot)
+{
+	epoll_event clientEvent;
+	clientEvent.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+	clientEvent.data.u32 = (uint32_t)slot;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &clientEvent);
+}
+
+void EventReactor::removeClient(ClientHandle client)
+{
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, client, NULL);
+}
+
+void EventReactor::closeClient(ClientHandle client)
+{
+	close(client);
+}
+
+int EventReactor::receive(ClientHandle client, char *buffer, int length)
+{
+	while (true)
+	{
+		ssize_t received = recv(client, buffer, length, 0);
+
+		if (received > 0) { return (int)received; }
+		if (received == 0) { return RECEIVE_CLOSED; }
+		if (errno == EINTR) { continue; }
+		if (errno == EAGAIN || errno == EWOULDBLOCK) { return RECEIVE_WOULD_BLOCK; }
+
+		return RECEIVE_CLOSED;
+	}
+}
+
+bool EventReactor::sendAll(ClientHandle client, const char *data, int length)
+{
+	int sent = 0;
+
+	while (sent < length)
+	{
+		ssize_t result = send(client, data + sent, length - sent, MSG_NOSIGNAL);
+
+		if (result > 0)
+		{
+			sent += (int)result;
+		}
+		else if (result == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			// The socket buffer is full - wait (briefly) for it to drain rather than dropping half a message
+			pollfd writable;
+			writable.fd = client;
+			writable.events = POLLOUT;
+			if (poll(&writable, 1, 100) <= 0) { return false; }
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int EventReactor::sendSome(ClientHandle client, const char *data, int length)
+{
+	while (true)
+	{
+		ssize_t result = send(client, data, length, MSG_NOSIGNAL);
+
+		if (result >= 0) { return (int)result; }
+		if (errno == EINTR) { continue; }
+
+		// A full socket buffer just means nothing went this time
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+	}
+}
+
+int EventReactor::sendSome(ClientHandle client, const SendBuffer *buffers, int count)
+{
+	// SendBuffer is laid out differently from iovec (iov_base isn't const), so copy across
+	iovec pieces[MAX_SEND_BUFFERS];
+	if (count > MAX_SEND_BUFFERS) { count = MAX_SEND_BUFFERS; }
+
+	for (int i = 0; i < count; i++)
+	{
+		pieces[i].iov_base = (void *)buffers[i].data;
+		pieces[i].iov_len = buffers[i].length;
+	}
+
+	while (true)
+	{
+		// sendmsg rather than writev so we can pass MSG_NOSIGNAL
+		msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = pieces;
+		message.msg_iovlen = count;
+
+		ssize_t result = sendmsg(client, &message, MSG_NOSIGNAL);
+
+		if (result >= 0) { return (int)result; }
+		if (errno == EINTR) { continue; }
+
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+	}
+}
+
+#else // SDL_net fallback
+
+EventReactor::EventReactor(unsigned int thePort, unsigned int theMaxSockets)
+{
+	port = thePort;
+	maxSockets = theMaxSockets;
+	listenerReady = false;
+	udpReady = false;
+	udpSocket = NULL;
+	udpPacket = NULL;
+
+	// Create the socket set with enough space to store our desired number of connections (i.e. sockets), plus the
+	// UDP socket if we open one
+	socketSet = SDLNet_AllocSocketSet(maxSockets + 1);
+	if (socketSet == NULL)
+	{
+		string msg = "Failed to allocate the socket set: ";
+		msg += SDLNet_GetError();
+
+		SocketException e(msg);
+		throw e;
+	}
+
+	// Passing NULL as the host means "make a listening port"
+	if (SDLNet_ResolveHost(&serverIP, NULL, port) == -1)
+	{
+		string msg = "Failed to open the server socket: ";
+		msg += SDLNet_GetError();
+
+		SocketException e(msg);
+		throw e;
+	}
+
+	serverSocket = SDLNet_TCP_Open(&serverIP);
+	if (!serverSocket)
+	{
+		string msg = "Failed to open the server socket: ";
+		msg += SDLNet_GetError();
+
+		SocketException e(msg);
+		throw e;
+	}
+
+	// Add our server socket (i.e. the listening socket) to the socket set
+	SDLNet_TCP_AddSocket(socketSet, serverSocket);
+}
+
+EventReactor::~EventReactor()
+{
+	if (udpSocket != NULL) { SDLNet_UDP_Close(udpSocket); }
+	if (udpPacket != NULL) { SDLNet_FreePacket(udpPacket); }
+	SDLNet_TCP_Close(serverSocket);
+	SDLNet_FreeSocketSet(socketSet);
+}
+
+int EventReactor::wait(int timeoutMs)
+{
+	readySlots.clear();
+
+	// SDL_net takes an unsigned timeout where -1 means "wait for up to 49 days", which is close enough to forever
+	int numActiveSockets = SDLNet_CheckSockets(socketSet, (Uint32)timeoutMs);
+
+	if (numActiveSockets <= 0)
+	{
+		listenerReady = false;
+		udpReady = false;
+		return 0;
+	}
+
+	listenerReady = SDLNet_SocketReady(serverSocket) != 0;
+	udpReady = udpSocket != NULL && SDLNet_SocketReady(udpSocket) != 0;
+
+	for (unsigned int i = 0; i < registeredSockets.size(); i++)
+	{
+		if (SDLNet_SocketReady(registeredSockets[i]))
+		{
+			readySlots.push_back(registeredSlots[i]);
+		}
+	}
+
+	return numActiveSockets;
+}
+
+ClientHandle EventReactor::acceptClient()
+{
+	// SDL_net only tells us the listener is readable, so accept the one connection we know is there
+	if (!listenerReady) { return NO_CLIENT; }
+
+	listenerReady = false;
+	return SDLNet_TCP_Accept(serverSocket);
+}
+
+void EventReactor::addClient(ClientHandle client, int slot)
+{
+	SDLNet_TCP_AddSocket(socketSet, client);
+	registeredSockets.push_back(client);
+	registeredSlots.push_back(slot);
+}
+
+void EventReactor::removeClient(ClientHandle client)
+{
+	SDLNet_TCP_DelSocket(socketSet, client);
+
+	// Swap the last registered socket into the hole so the arrays stay packed
+	for (unsigned int i = 0; i < registeredSockets.size(); i++)
+	{
+		if (registeredSockets[i] == client)
+		{
+			registeredSockets[i] = registeredSockets.back();
+			registeredSlots[i] = registeredSlots.back();
+			registeredSockets.pop_back();
+			registeredSlots.pop_back();
+			break;
+		}
+	}
+}
+
+void EventReactor::closeClient(ClientHandle client)
+{
+	SDLNet_TCP_Close(client);
+}
+
+int EventReactor::receive(ClientHandle client, char *buffer, int length)
+{
+	// SDLNet_TCP_Recv blocks, so only read when CheckSockets said there was something there (the ready flag
+	// is cleared by the read, so the next call reports the socket as drained)
+	if (!SDLNet_SocketReady(client)) { return RECEIVE_WOULD_BLOCK; }
+
+	int received = SDLNet_TCP_Recv(client, buffer, length);
+
+	return received > 0 ? received : RECEIVE_CLOSED;
+}
+
+bool EventReactor::sendAll(ClientHandle client, const char *data, int length)
+{
+	return SDLNet_TCP_Send(client, data, length) == length;
+}
+
+bool EventReactor::openUdp()
+{
+	if (udpSocket != NULL) { return true; }
+
+	udpSocket = SDLNet_UDP_Open((Uint16)port);
+	if (udpSocket == NULL) { return false; }
+
+	udpPacket = SDLNet_AllocPacket(64 * 1024);
+	if (udpPacket == NULL)
+	{
+		SDLNet_UDP_Close(udpSocket);
+		udpSocket = NULL;
+		return false;
+	}
+
+	SDLNet_UDP_AddSocket(socketSet, udpSocket);
+	return true;
+}
+
+int EventReactor::receiveDatagram(char *buffer, int length, UdpAddress &from)
+{
+	// SDLNet_UDP_Recv doesn't block, and returns 0 once there's nothing left
+	if (SDLNet_UDP_Recv(udpSocket, udpPacket) != 1)
+	{
+		udpReady = false;
+		return -1;
+	}
+
+	int received = udpPacket->len < length ? udpPacket->len : length;
+	memcpy(buffer, udpPacket->data, received);
+	from.host = udpPacket->address.host;
+	from.port = udpPacket->address.port;
+	return received;
+}
+
+bool EventReactor::sendDatagram(const UdpAddress &to, const char *data, int length)
+{
+	if (length > udpPacket->maxlen) { return false; }
+
+	memcpy(udpPacket->data, data, length);
+	udpPacket->len = length;
+	udpPacket->address.host = to.host;
+	udpPacket->address.port = to.port;
+
+	return SDLNet_UDP_Send(udpSocket, -1, udpPacket) != 0;
+}
+
+// SDL_net sockets block, so this always sends everything (or fails)
+int EventReactor::sendSome(ClientHandle client, const char *data, int length)
+{
+	return SDLNet_TCP_Send(client, data, length) == length ? length : -1;
+}
+
+int EventReactor::sendSome(ClientHandle client, const SendBuffer *buffers, int count)
+{
+	int sent = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (SDLNet_TCP_Send(client, buffers[i].data, (int)buffers[i].length) != (int)buffers[i].length) { return -1; }
+		sent += (int)buffers[i].length;
+	}
+
+	return sent;
+}
+
+// The socket set can't be interrupted, so anything waiting on a wakeup just waits for the next timeout instead
+void EventReactor::wake()
+{
+}
+
+// SDL_net can't share a port between sockets, so connections are always accepted on the network thread
+bool EventReactor::startAcceptors(unsigned int numAcceptors)
+{
+	return numAcceptors == 0;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef EVENT_REACTOR_H
+#define EVENT_REACTOR_H
+
+#include <vector>
+#include <cstdint>
+#include "SDL_net.h"
+#include "SocketException.h"
+
+// On Linux we drive the sockets ourselves with epoll (edge-triggered, non-blocking sockets) so that each wakeup
+// only hands back the descriptors that actually have something for us. Everywhere else (i.e. the Windows build)
+// we fall back to the SDL_net socket set, but still only walk the sockets that are actually connected.
+#if defined(__linux__)
+#define SERVER_USE_EPOLL 1
+#endif
+
+#ifdef SERVER_USE_EPOLL
+#include <sys/epoll.h>
+#include <thread>
+#include "MpscQueue.h"
+
+typedef int ClientHandle;                 // A raw, non-blocking socket descriptor
+const ClientHandle NO_CLIENT = -1;
+#else
+typedef TCPsocket ClientHandle;           // An SDL_net socket
+const ClientHandle NO_CLIENT = NULL;
+#endif
+
+// Most buffers EventReactor::sendSome will send in one go (any more are left for the next call)
+const int MAX_SEND_BUFFERS = 64;
+
+// Return values for EventReactor::receive() when no bytes were read
+const int RECEIVE_WOULD_BLOCK = 0;        // Nothing more to read until the next readiness event
+const int RECEIVE_CLOSED = -1;            // The client disconnected (or the socket errored)
+
+// Where a UDP datagram came from (or is going to). Both in network byte order
+struct UdpAddress
+{
+	uint32_t host;
+	uint16_t port;
+};
+
+inline bool operator==(const UdpAddress &a, const UdpAddress &b) { return a.host == b.host && a.port == b.port; }
+
+// Pack an address into one key, i.e. for hash maps
+inline uint64_t udpAddressKey(const UdpAddress &address) { return ((uint64_t)address.host << 16) | address.port; }
+
+// One piece of a scatter/gather send
+struct SendBuffer
+{
+	const char *data;
+	size_t length;
+};
+
+class EventReactor
+{
+private:
+	unsigned int port;                    // The port we are listening on
+	unsigned int maxSockets;              // Max number of sockets (listener + clients)
+
+	bool listenerReady;                   // Set by wait() when there are connections waiting to be accepted
+	bool udpReady;                        // Set by wait() when there are datagrams waiting to be read
+	std::vector<int> readySlots;          // Client slots reported ready by the last call to wait()
+
+#ifdef SERVER_USE_EPOLL
+	int listenFd;                         // The listening socket
+	int epollFd;                          // The epoll instance all our sockets are registered with
+	int wakeFd;                           // eventfd other threads write to to wake wait() up
+	int udpFd;                            // The UDP socket (see openUdp), -1 if there isn't one
+	std::vector<epoll_event> events;      // Event array handed to epoll_wait
+
+	// Acceptor threads (see startAcceptors), each with its own listening socket on the port - the first one takes
+	// over listenFd and the rest are opened with SO_REUSEPORT, so the kernel spreads new connections between them
+	std::vector<std::thread> acceptors;
+	std::vector<int> acceptorFds;         // The extra listening sockets
+	int stopAcceptorsFd;                  // eventfd that tells the acceptors to finish
+	MpscQueue<int> acceptedClients;       // Connections the acceptors have accepted, waiting for acceptClient()
+
+	void acceptorLoop(int fd);
+#else
+	IPaddress serverIP;                   // The IP of the socket server (0.0.0.0 i.e. "any IP address")
+	TCPsocket serverSocket;               // The server socket that clients will connect to
+	SDLNet_SocketSet socketSet;           // Our entire set of sockets
+	UDPsocket udpSocket;                  // The UDP socket (see openUdp), NULL if there isn't one
+	UDPpacket *udpPacket;                 // Somewhere for SDL_net to put datagrams (and take them from)
+
+	// Connected sockets and the slot each one belongs to, kept packed so wait() is O(connected) not O(maxClients)
+	std::vector<TCPsocket> registeredSockets;
+	std::vector<int> registeredSlots;
+#endif
+
+public:
+	EventReactor(unsigned int port, unsigned int maxSockets);
+	~EventReactor();
+
+	// Block for up to timeoutMs milliseconds (-1 means forever) waiting for socket activity.
+	// Returns the number of ready sockets, which can then be inspected with hasPendingConnections() and getReadySlots()
+	int wait(int timeoutMs);
+
+	// Make a wait() that's in progress (or the next one) return straight away. Safe to call from any thread
+	void wake();
+
+	// Accept connections on this many threads of their own instead of in wait()/acceptClient(), so a storm of
+	// connections (i.e. everyone reconnecting after a restart) is taken off the backlog as fast as it arrives rather
+	// than between everything else the network thread does. acceptClient() then hands back what they've accepted.
+	// Only call once, before the first wait(). Returns false if it's not supported (the SDL_net build)
+	bool startAcceptors(unsigned int numAcceptors);
+
+	bool hasPendingConnections() { return listenerReady; }
+	bool hasPendingDatagrams() { return udpReady; }
+	const std::vector<int>& getReadySlots() { return readySlots; }
+
+	// Accept one pending connection, or return NO_CLIENT if there are none left to accept
+	ClientHandle acceptClient();
+
+	// Start/stop watching a client socket. The slot is handed back by getReadySlots() when the socket is readable
+	void addClient(ClientHandle client, int slot);
+	void removeClient(ClientHandle client);
+
+	// Open a UDP socket on the same port number as the listener and watch it along with everything else. Returns false
+	// if it couldn't be opened
+	bool openUdp();
+
+	// Read one datagram of up to length bytes, saying who it came from. Returns its length, or -1 when there are none
+	// left to read
+	int receiveDatagram(char *buffer, int length, UdpAddress &from);
+
+	// Send a datagram (no waiting - if it can't go right now it's dropped, which is what UDP's for). Returns false if
+	// it didn't go
+	bool sendDatagram(const UdpAddress &to, const char *data, int length);
+
+	// Close a client socket (call removeClient first)
+	void closeClient(ClientHandle client);
+
+	// Read up to length bytes. Returns the byte count, RECEIVE_WOULD_BLOCK when the socket has been drained,
+	// or RECEIVE_CLOSED when the client has gone away
+	int receive(ClientHandle client, char *buffer, int length);
+
+	// Send the whole buffer to a client. Returns false if the client could not be written to
+	bool sendAll(ClientHandle client, const char *data, int length);
+
+	// Send as much of the buffer as the socket will take right now without blocking. Returns the number of bytes
+	// sent (0 if the socket buffer is full), or -1 if the client could not be written to
+	int sendSome(ClientHandle client, const char *data, int length);
+
+	// Same again for several buffers at once, sent back to back in one call (writev)
+	int sendSome(ClientHandle client, const SendBuffer *buffers, int count);
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "MessageFramer.h"
+#include "WireProtocol.h"
+#include <cstring>
+
+MessageFramer::MessageFramer()
+{
+	readPos = 0;
+	used = 0;
+	scanned = 0;
+	maxFrameSize = 0;
+	mode = FRAMING_TEXT;
+	overflowed = false;
+}
+
+void MessageFramer::reset(size_t initialCapacity, size_t theMaxFrameSize)
+{
+	// Round the capacity up to a power of two so we can wrap positions with a mask
+	size_t capacity = 64;
+	while (capacity < initialCapacity) { capacity *= 2; }
+
+	ring.assign(capacity, 0);
+	readPos = 0;
+	used = 0;
+	scanned = 0;
+	maxFrameSize = theMaxFrameSize;
+	mode = FRAMING_TEXT;
+	overflowed = false;
+}
+
+// Double the size of the ring, unwrapping the waiting bytes to the start of the new buffer
+void MessageFramer::grow()
+{
+	std::vector<char> bigger(ring.size() * 2);
+	copyOut(0, used, &bigger[0]);
+	ring.swap(bigger);
+	readPos = 0;
+}
+
+// Copy length bytes starting offset bytes after readPos, taking care of the wrap
+void MessageFramer::copyOut(size_t offset, size_t length, char *destination)
+{
+	size_t mask = ring.size() - 1;
+	size_t start = (readPos + offset) & mask;
+	size_t firstPart = ring.size() - start;
+
+	if (firstPart >= length)
+	{
+		memcpy(destination, &ring[start], length);
+	}
+	else
+	{
+		memcpy(destination, &ring[start], firstPart);
+		memcpy(destination + firstPart, &ring[0], length - firstPart);
+	}
+}
+
+char *MessageFramer::getWriteSpace(int &length)
+{
+	if (used == ring.size())
+	{
+		// Full without a complete frame in it. Allow room for one maximum size frame (plus its header) and no more
+		if (ring.size() >= maxFrameSize + FRAME_HEADER_SIZE)
+		{
+			overflowed = true;
+			length = 0;
+			return NULL;
+		}
+
+		grow();
+	}
+
+	size_t mask = ring.size() - 1;
+	size_t writePos = (readPos + used) & mask;
+
+	// Free space runs either to the end of the ring, or up to where the waiting data starts
+	if (writePos >= readPos && used != 0)
+	{
+		length = (int)(ring.size() - writePos);
+	}
+	else if (used == 0)
+	{
+		readPos = 0;
+		writePos = 0;
+		length = (int)ring.size();
+	}
+	else
+	{
+		length = (int)(readPos - writePos);
+	}
+
+	return &ring[writePos];
+}
+
+void MessageFramer::commitWrite(int length)
+{
+	used += length;
+}
+
+bool MessageFramer::nextFrame(const char *&frame, int &length)
+{
+	size_t mask = ring.size() - 1;
+	size_t frameStart;   // Offset (from readPos) of the first payload byte
+	size_t frameLength;  // Payload bytes
+	size_t consumed;     // Total bytes to remove from the ring, including any header or terminator
+
+	if (mode == FRAMING_TEXT)
+	{
+		// Look for the NUL terminator, carrying on from wherever we got to last time
+		size_t terminator = used;
+		for (size_t i = scanned; i < used; i++)
+		{
+			if (ring[(readPos + i) & mask] == '\0')
+			{
+				terminator = i;
+				break;
+			}
+		}
+
+		if (terminator == used)
+		{
+			scanned = used;
+			if (used > maxFrameSize) { overflowed = true; }
+			return false;
+		}
+
+		frameStart = 0;
+		frameLength = terminator;
+		consumed = terminator + 1;
+	}
+	else
+	{
+		if (used < FRAME_HEADER_SIZE) { return false; }
+
+		frameLength = 0;
+		for (size_t i = 0; i < FRAME_HEADER_SIZE; i++)
+		{
+			frameLength = (frameLength << 8) | (unsigned char)ring[(readPos + i) & mask];
+		}
+
+		if (frameLength > maxFrameSize)
+		{
+			overflowed = true;
+			return false;
+		}
+
+		if (used < FRAME_HEADER_SIZE + frameLength) { return false; }
+
+		frameStart = FRAME_HEADER_SIZE;
+		consumed = FRAME_HEADER_SIZE + frameLength;
+	}
+
+	// Hand back a pointer straight into the ring if we can, otherwise unwrap the frame into the scratch buffer
+	size_t start = (readPos + frameStart) & mask;
+	if (start + frameLength <= ring.size())
+	{
+		frame = &ring[start];
+	}
+	else
+	{
+		if (scratch.size() < frameLength) { scratch.resize(frameLength); }
+		copyOut(frameStart, frameLength, &scratch[0]);
+		frame = &scratch[0];
+	}
+	length = (int)frameLength;
+
+	readPos = (readPos + consumed) & mask;
+	used -= consumed;
+	scanned = 0;
+
+	return true;
+}
+
+int MessageFramer::makeHeader(FramingMode mode, const char *data, int &length, char *header)
+{
+	if (mode == FRAMING_TEXT) { return 0; }
+
+	// The terminator is only there for text framing (binary messages can legitimately end in a zero byte)
+	if (length > 0 && !isBinaryMessage(data, length) && data[length - 1] == '\0') { length--; }
+
+	header[0] = (char)((length >> 24) & 0xFF);
+	header[1] = (char)((length >> 16) & 0xFF);
+	header[2] = (char)((length >> 8) & 0xFF);
+	header[3] = (char)(length & 0xFF);
+
+	return FRAME_HEADER_SIZE;
+}
+
+void MessageFramer::appendFramed(FramingMode mode, const char *data, int length, std::string &out)
+{
+	char header[FRAME_HEADER_SIZE];
+	int headerLength = makeHeader(mode, data, length, header);
+
+	out.append(header, headerLength);
+	out.append(data, length);
+}
@@ -0,0 +1,70 @@
+#ifndef MESSAGE_FRAMER_H
+#define MESSAGE_FRAMER_H
+
+#include <vector>
+#include <string>
+
+// How messages are delimited on a connection. Clients start off in FRAMING_TEXT (every message is a
+// NUL-terminated string, which is what the existing client sends) and can switch to FRAMING_LENGTH_PREFIXED
+// by sending the "!frame~" handshake, after which every message in both directions is a 4-byte big-endian
+// length followed by that many bytes of payload.
+enum FramingMode
+{
+	FRAMING_TEXT,
+	FRAMING_LENGTH_PREFIXED
+};
+
+const unsigned int FRAME_HEADER_SIZE = 4;
+
+// Per-client receive ring buffer. TCP is a byte stream, so a single read can hold half a message, or several
+// messages run together - the framer keeps hold of the bytes until whole frames are available, and then hands
+// them back one at a time.
+class MessageFramer
+{
+private:
+	std::vector<char> ring;     // The ring buffer itself (capacity is always a power of two)
+	size_t readPos;             // Where the oldest unconsumed byte is
+	size_t used;                // How many bytes are waiting in the ring
+	size_t scanned;             // How many bytes we've already searched for a terminator (text mode only)
+	size_t maxFrameSize;        // Largest frame we'll accept before deciding the client is misbehaving
+
+	std::vector<char> scratch;  // Somewhere to put a frame that wraps round the end of the ring
+	FramingMode mode;
+	bool overflowed;            // Set when the client sent a frame bigger than maxFrameSize
+
+	void grow();
+	void copyOut(size_t offset, size_t length, char *destination);
+
+public:
+	MessageFramer();
+
+	// Empty the buffer ready for a new connection
+	void reset(size_t initialCapacity, size_t theMaxFrameSize);
+
+	FramingMode getMode() { return mode; }
+	void setMode(FramingMode theMode) { mode = theMode; }
+
+	// True if the client has sent something we can't frame (the connection should be dropped)
+	bool hasError() { return overflowed; }
+
+	// Get a contiguous block of free space to receive into. Returns NULL if the buffer is full and can't grow
+	char *getWriteSpace(int &length);
+
+	// Tell the framer how many bytes were written into the space given out by getWriteSpace
+	void commitWrite(int length);
+
+	// Get the next complete frame, if there is one. The pointer stays valid until the next call to
+	// getWriteSpace or nextFrame
+	bool nextFrame(const char *&frame, int &length);
+
+	// Append a framed copy of a message to out, ready to be sent to a client using the given mode.
+	// Text framing sends the message as-is; length-prefixed framing drops any trailing NUL from a text message and
+	// adds the header
+	static void appendFramed(FramingMode mode, const char *data, int length, std::string &out);
+
+	// The same thing in pieces, for when the message itself isn't copied: fills in the header to send in front of
+	// the message (returning its size, 0 for text framing) and trims length to the bytes of the message to send
+	static int makeHeader(FramingMode mode, const char *data, int &length, char *header);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue for any number of producer threads and a single consumer (Dmitry Vyukov's intrusive
+// MPSC design). push() is one atomic exchange and never waits; pop() is only ever called from the consumer thread.
+//
+// A push that's halfway through (it's swapped itself in but not linked up yet) hides anything pushed after it until
+// it finishes, so pop() can come back empty for a moment while items are still arriving. Anything missed is there
+// the next time the consumer drains the queue.
+template<class T>
+class MpscQueue
+{
+private:
+	struct Node
+	{
+		std::atomic<Node *> next;
+		T value;
+
+		Node() : next(nullptr) {}
+		Node(const T &theValue) : next(nullptr), value(theValue) {}
+	};
+
+	std::atomic<Node *> head;   // Most recently pushed node (producers swap themselves in here)
+	Node *tail;                 // Already-popped node in front of the next one to pop (consumer only)
+
+public:
+	MpscQueue()
+	{
+		Node *stub = new Node();
+		head.store(stub, std::memory_order_relaxed);
+		tail = stub;
+	}
+
+	~MpscQueue()
+	{
+		T discarded;
+		while (pop(discarded)) {}
+		delete tail;
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	// Safe from any thread
+	void push(const T &value)
+	{
+		Node *node = new Node(value);
+		Node *previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	// Consumer thread only. Returns false if there's nothing (finished being) pushed
+	bool pop(T &value)
+	{
+		Node *next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr) { return false; }
+
+		value = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "OutboundQueue.h"
+
+// Once the owned buffer gets this big we start reclaiming the part of it that's been sent
+static const size_t OWNED_COMPACT_SIZE = 64 * 1024;
+
+void OutboundQueue::clear()
+{
+	segments.clear();
+	owned.clear();
+	queuedBytes = 0;
+}
+
+void OutboundQueue::appendOwned(const char *data, size_t length)
+{
+	if (length == 0) { return; }
+
+	// Run straight on from the last segment if that's where it ends, so lots of small messages go out as one piece
+	if (!segments.empty() && !segments.back().shared && segments.back().offset + segments.back().length == owned.length())
+	{
+		segments.back().length += length;
+	}
+	else
+	{
+		Segment segment;
+		segment.offset = owned.length();
+		segment.length = length;
+		segments.push_back(segment);
+	}
+
+	owned.append(data, length);
+	queuedBytes += length;
+}
+
+void OutboundQueue::append(FramingMode mode, const char *data, int length)
+{
+	char header[FRAME_HEADER_SIZE];
+	int headerLength = MessageFramer::makeHeader(mode, data, length, header);
+
+	appendOwned(header, headerLength);
+	appendOwned(data, length);
+}
+
+void OutboundQueue::append(FramingMode mode, const SharedPayload &payload)
+{
+	int length = (int)payload->length();
+
+	char header[FRAME_HEADER_SIZE];
+	int headerLength = MessageFramer::makeHeader(mode, payload->data(), length, header);
+
+	appendOwned(header, headerLength);
+
+	if (length > 0)
+	{
+		Segment segment;
+		segment.shared = payload;
+		segment.offset = 0;
+		segment.length = length;
+		segments.push_back(segment);
+
+		queuedBytes += length;
+	}
+}
+
+void OutboundQueue::appendFramed(const SharedPayload &payload)
+{
+	if (payload->empty()) { return; }
+
+	Segment segment;
+	segment.shared = payload;
+	segment.offset = 0;
+	segment.length = payload->length();
+	segments.push_back(segment);
+
+	queuedBytes += payload->length();
+}
+
+bool OutboundQueue::flush(EventReactor &reactor, ClientHandle client)
+{
+	SendBuffer buffers[MAX_SEND_BUFFERS];
+
+	while (!segments.empty())
+	{
+		int count = 0;
+		size_t batchBytes = 0;
+
+		for (std::deque<Segment>::const_iterator segment = segments.begin(); segment != segments.end() && count < MAX_SEND_BUFFERS; segment++)
+		{
+			const std::string &bytes = segment->shared ? *segment->shared : owned;
+			buffers[count].data = bytes.data() + segment->offset;
+			buffers[count].length = segment->length;
+			batchBytes += segment->length;
+			count++;
+		}
+
+		int result = reactor.sendSome(client, buffers, count);
+		if (result < 0) { return false; }
+
+		// Drop whatever went, and trim the segment the send stopped part way through
+		size_t sent = (size_t)result;
+		queuedBytes -= sent;
+
+		while (sent > 0)
+		{
+			Segment &front = segments.front();
+
+			if (sent >= front.length)
+			{
+				sent -= front.length;
+				segments.pop_front();
+			}
+			else
+			{
+				front.offset += sent;
+				front.length -= sent;
+				sent = 0;
+			}
+		}
+
+		// Socket's full (or there were more segments than fit in one send and it took them all, so go round again)
+		if ((size_t)result < batchBytes) { break; }
+	}
+
+	// Once nothing's waiting, the owned buffer can start again from the beginning (keeping its capacity)
+	if (segments.empty())
+	{
+		owned.clear();
+	}
+	else if (owned.length() > OWNED_COMPACT_SIZE)
+	{
+		// A client that's behind may never empty its queue, so throw away the part of owned that's already gone
+		size_t firstUnsent = owned.length();
+		for (std::deque<Segment>::const_iterator segment = segments.begin(); segment != segments.end(); segment++)
+		{
+			if (!segment->shared) { firstUnsent = segment->offset; break; }
+		}
+
+		if (firstUnsent > owned.length() / 2)
+		{
+			owned.erase(0, firstUnsent);
+
+			for (std::deque<Segment>::iterator segment = segments.begin(); segment != segments.end(); segment++)
+			{
+				if (!segment->shared) { segment->offset -= firstUnsent; }
+			}
+		}
+	}
+
+	return true;
+}
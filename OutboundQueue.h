@@ -0,0 +1,64 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <string>
+#include <deque>
+#include <memory>
+#include "MessageFramer.h"
+#include "EventReactor.h"
+
+// A message that's built once and sent to lots of clients. Each client's queue just holds a reference to it, so a
+// broadcast costs one copy of the message however many clients it goes to. The string holds the message the way a
+// text client gets it (NUL terminator included), and is never changed once made.
+typedef std::shared_ptr<const std::string> SharedPayload;
+
+inline SharedPayload makePayload(const char *data, size_t length)
+{
+	return std::make_shared<const std::string>(data, length);
+}
+
+// Per-client send queue. Everything sent to a client during a tick is queued here, then the whole lot goes out in
+// one non-blocking writev when the tick is flushed. Whatever the socket doesn't take stays queued for the next
+// flush, so one slow client never holds up the rest of the server.
+//
+// Messages only this client gets (and the length headers for shared messages) are copied into a buffer the queue
+// owns, and shared messages are referenced where they are.
+class OutboundQueue
+{
+private:
+	// A run of bytes to send: part of a shared message, or (when shared is empty) part of owned
+	struct Segment
+	{
+		SharedPayload shared;
+		size_t offset;
+		size_t length;
+	};
+
+	std::deque<Segment> segments;
+	std::string owned;          // Bytes the queue copied itself
+	size_t queuedBytes;
+
+	void appendOwned(const char *data, size_t length);
+
+public:
+	OutboundQueue() : queuedBytes(0) {}
+
+	// Throw away anything queued (i.e. when the slot is handed to a new client)
+	void clear();
+
+	// Queue a copy of a message, framed for the given mode (see MessageFramer::appendFramed)
+	void append(FramingMode mode, const char *data, int length);
+
+	// Queue a shared message without copying it
+	void append(FramingMode mode, const SharedPayload &payload);
+
+	// Queue a shared message that's already framed for this client (i.e. a batch of several messages)
+	void appendFramed(const SharedPayload &payload);
+
+	size_t getQueuedBytes() const { return queuedBytes; }
+
+	// Send as much as the socket will take. Returns false if the connection is broken
+	bool flush(EventReactor &reactor, ClientHandle client);
+};
+
+#endif
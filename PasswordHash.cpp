@@ -0,0 +1,431 @@
+#include "PasswordHash.h"
+#include <vector>
+#include <random>
+#include <cstring>
+
+using namespace std;
+
+static const size_t SALT_BYTES = 16;
+static const size_t HASH_BYTES = 32;
+static const unsigned int SCRYPT_R = 8;
+static const unsigned int SCRYPT_P = 1;
+
+// Refuse parameters that would need more memory than this per hash
+static const uint64_t MAX_SCRYPT_MEMORY = 1ull << 30;
+
+static const char HASH_PREFIX[] = "$scrypt$";
+
+//////////////////// SHA-256 (FIPS 180-4) ////////////////////
+
+static const uint32_t SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+struct Sha256
+{
+	uint32_t state[8];
+	uint8_t block[64];
+	size_t blockUsed;
+	uint64_t totalLength;
+
+	Sha256()
+	{
+		static const uint32_t initial[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+		memcpy(state, initial, sizeof(state));
+		blockUsed = 0;
+		totalLength = 0;
+	}
+
+	static uint32_t rotr(uint32_t value, int bits) { return (value >> bits) | (value << (32 - bits)); }
+
+	void compress(const uint8_t *data)
+	{
+		uint32_t w[64];
+		for (int i = 0; i < 16; i++)
+		{
+			w[i] = ((uint32_t)data[i * 4] << 24) | ((uint32_t)data[i * 4 + 1] << 16) | ((uint32_t)data[i * 4 + 2] << 8) | data[i * 4 + 3];
+		}
+		for (int i = 16; i < 64; i++)
+		{
+			uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+
+		for (int i = 0; i < 64; i++)
+		{
+			uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+			uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+	}
+
+	void update(const uint8_t *data, size_t length)
+	{
+		totalLength += length;
+
+		while (length > 0)
+		{
+			if (blockUsed == 0 && length >= 64)
+			{
+				compress(data);
+				data += 64;
+				length -= 64;
+				continue;
+			}
+
+			size_t take = min(length, 64 - blockUsed);
+			memcpy(block + blockUsed, data, take);
+			blockUsed += take;
+			data += take;
+			length -= take;
+
+			if (blockUsed == 64)
+			{
+				compress(block);
+				blockUsed = 0;
+			}
+		}
+	}
+
+	void finish(uint8_t digest[32])
+	{
+		uint64_t bits = totalLength * 8;
+		uint8_t padding[72] = { 0x80 };
+		size_t paddingLength = (blockUsed < 56 ? 56 : 120) - blockUsed;
+
+		for (int i = 0; i < 8; i++) { padding[paddingLength + i] = (uint8_t)(bits >> (56 - i * 8)); }
+		update(padding, paddingLength + 8);
+
+		for (int i = 0; i < 8; i++)
+		{
+			digest[i * 4] = (uint8_t)(state[i] >> 24);
+			digest[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+			digest[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+			digest[i * 4 + 3] = (uint8_t)state[i];
+		}
+	}
+};
+
+void sha256(const uint8_t *data, size_t length, uint8_t digest[32])
+{
+	Sha256 context;
+	context.update(data, length);
+	context.finish(digest);
+}
+
+//////////////////// HMAC-SHA-256 (RFC 2104) and PBKDF2 (RFC 8018) ////////////////////
+
+// The inner and outer hashes with the key already fed in, so each HMAC after the first only hashes the message
+struct HmacSha256
+{
+	Sha256 inner;
+	Sha256 outer;
+
+	HmacSha256(const uint8_t *key, size_t keyLength)
+	{
+		uint8_t keyBlock[64] = { 0 };
+		if (keyLength > 64) { sha256(key, keyLength, keyBlock); }
+		else { memcpy(keyBlock, key, keyLength); }
+
+		uint8_t pad[64];
+		for (int i = 0; i < 64; i++) { pad[i] = keyBlock[i] ^ 0x36; }
+		inner.update(pad, 64);
+		for (int i = 0; i < 64; i++) { pad[i] = keyBlock[i] ^ 0x5c; }
+		outer.update(pad, 64);
+	}
+};
+
+void pbkdf2Sha256(const uint8_t *password, size_t passwordLength, const uint8_t *salt, size_t saltLength,
+	uint64_t iterations, uint8_t *output, size_t outputLength)
+{
+	HmacSha256 keyed(password, passwordLength);
+
+	for (uint32_t blockNumber = 1; outputLength > 0; blockNumber++)
+	{
+		uint8_t counter[4] = { (uint8_t)(blockNumber >> 24), (uint8_t)(blockNumber >> 16), (uint8_t)(blockNumber >> 8), (uint8_t)blockNumber };
+		uint8_t u[32];
+		uint8_t t[32];
+
+		HmacSha256 first = keyed;
+		first.inner.update(salt, saltLength);
+		first.inner.update(counter, 4);
+		first.inner.finish(u);
+		first.outer.update(u, 32);
+		first.outer.finish(u);
+		memcpy(t, u, 32);
+
+		for (uint64_t i = 1; i < iterations; i++)
+		{
+			HmacSha256 next = keyed;
+			next.inner.update(u, 32);
+			next.inner.finish(u);
+			next.outer.update(u, 32);
+			next.outer.finish(u);
+			for (int j = 0; j < 32; j++) { t[j] ^= u[j]; }
+		}
+
+		size_t take = min(outputLength, (size_t)32);
+		memcpy(output, t, take);
+		output += take;
+		outputLength -= take;
+	}
+}
+
+//////////////////// scrypt (RFC 7914) ////////////////////
+
+static inline uint32_t rotl(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+// Salsa20/8 core, in place on 16 words
+static void salsa208(uint32_t b[16])
+{
+	uint32_t x[16];
+	memcpy(x, b, sizeof(x));
+
+	for (int i = 0; i < 8; i += 2)
+	{
+		x[4] ^= rotl(x[0] + x[12], 7);   x[8] ^= rotl(x[4] + x[0], 9);
+		x[12] ^= rotl(x[8] + x[4], 13);  x[0] ^= rotl(x[12] + x[8], 18);
+		x[9] ^= rotl(x[5] + x[1], 7);    x[13] ^= rotl(x[9] + x[5], 9);
+		x[1] ^= rotl(x[13] + x[9], 13);  x[5] ^= rotl(x[1] + x[13], 18);
+		x[14] ^= rotl(x[10] + x[6], 7);  x[2] ^= rotl(x[14] + x[10], 9);
+		x[6] ^= rotl(x[2] + x[14], 13);  x[10] ^= rotl(x[6] + x[2], 18);
+		x[3] ^= rotl(x[15] + x[11], 7);  x[7] ^= rotl(x[3] + x[15], 9);
+		x[11] ^= rotl(x[7] + x[3], 13);  x[15] ^= rotl(x[11] + x[7], 18);
+
+		x[1] ^= rotl(x[0] + x[3], 7);    x[2] ^= rotl(x[1] + x[0], 9);
+		x[3] ^= rotl(x[2] + x[1], 13);   x[0] ^= rotl(x[3] + x[2], 18);
+		x[6] ^= rotl(x[5] + x[4], 7);    x[7] ^= rotl(x[6] + x[5], 9);
+		x[4] ^= rotl(x[7] + x[6], 13);   x[5] ^= rotl(x[4] + x[7], 18);
+		x[11] ^= rotl(x[10] + x[9], 7);  x[8] ^= rotl(x[11] + x[10], 9);
+		x[9] ^= rotl(x[8] + x[11], 13);  x[10] ^= rotl(x[9] + x[8], 18);
+		x[12] ^= rotl(x[15] + x[14], 7); x[13] ^= rotl(x[12] + x[15], 9);
+		x[14] ^= rotl(x[13] + x[12], 13); x[15] ^= rotl(x[14] + x[13], 18);
+	}
+
+	for (int i = 0; i < 16; i++) { b[i] += x[i]; }
+}
+
+// BlockMix on 2r 64 byte blocks, from in to out (which mustn't overlap)
+static void blockMix(const uint32_t *in, uint32_t *out, unsigned int r)
+{
+	uint32_t x[16];
+	memcpy(x, in + (2 * r - 1) * 16, sizeof(x));
+
+	for (unsigned int i = 0; i < 2 * r; i++)
+	{
+		for (int j = 0; j < 16; j++) { x[j] ^= in[i * 16 + j]; }
+		salsa208(x);
+
+		// Even blocks go in the first half of the output, odd ones in the second
+		memcpy(out + ((i & 1) * r + i / 2) * 16, x, sizeof(x));
+	}
+}
+
+static void roMix(uint8_t *block, unsigned int r, uint64_t n, vector<uint32_t> &v)
+{
+	const size_t words = 32 * r;
+	vector<uint32_t> x(words);
+	vector<uint32_t> y(words);
+
+	for (size_t i = 0; i < words; i++)
+	{
+		x[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) | ((uint32_t)block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+	}
+
+	for (uint64_t i = 0; i < n; i++)
+	{
+		memcpy(&v[i * words], x.data(), words * sizeof(uint32_t));
+		blockMix(x.data(), y.data(), r);
+		x.swap(y);
+	}
+
+	for (uint64_t i = 0; i < n; i++)
+	{
+		uint64_t j = x[(2 * r - 1) * 16] & (n - 1);
+		for (size_t k = 0; k < words; k++) { x[k] ^= v[j * words + k]; }
+		blockMix(x.data(), y.data(), r);
+		x.swap(y);
+	}
+
+	for (size_t i = 0; i < words; i++)
+	{
+		block[i * 4] = (uint8_t)x[i];
+		block[i * 4 + 1] = (uint8_t)(x[i] >> 8);
+		block[i * 4 + 2] = (uint8_t)(x[i] >> 16);
+		block[i * 4 + 3] = (uint8_t)(x[i] >> 24);
+	}
+}
+
+bool scrypt(const uint8_t *password, size_t passwordLength, const uint8_t *salt, size_t saltLength,
+	unsigned int cost, unsigned int r, unsigned int p, uint8_t *output, size_t outputLength)
+{
+	if (cost < MIN_PASSWORD_COST || cost > MAX_PASSWORD_COST || r == 0 || p == 0 || r > 64 || p > 16) { return false; }
+
+	uint64_t n = 1ull << cost;
+	if (128ull * r * n > MAX_SCRYPT_MEMORY) { return false; }
+
+	vector<uint8_t> b((size_t)128 * r * p);
+	pbkdf2Sha256(password, passwordLength, salt, saltLength, 1, b.data(), b.size());
+
+	vector<uint32_t> v((size_t)(32 * r * n));
+	for (unsigned int i = 0; i < p; i++)
+	{
+		roMix(&b[(size_t)128 * r * i], r, n, v);
+	}
+
+	pbkdf2Sha256(password, passwordLength, b.data(), b.size(), 1, output, outputLength);
+	return true;
+}
+
+//////////////////// the stored format ////////////////////
+
+static string toHex(const uint8_t *data, size_t length)
+{
+	static const char digits[] = "0123456789abcdef";
+	string hex;
+	for (size_t i = 0; i < length; i++)
+	{
+		hex.push_back(digits[data[i] >> 4]);
+		hex.push_back(digits[data[i] & 15]);
+	}
+	return hex;
+}
+
+static bool fromHex(string_view hex, vector<uint8_t> &data)
+{
+	if (hex.empty() || hex.length() % 2 != 0) { return false; }
+
+	data.clear();
+	for (size_t i = 0; i < hex.length(); i += 2)
+	{
+		int value = 0;
+		for (size_t j = i; j < i + 2; j++)
+		{
+			char c = hex[j];
+			value <<= 4;
+			if (c >= '0' && c <= '9') { value |= c - '0'; }
+			else if (c >= 'a' && c <= 'f') { value |= c - 'a' + 10; }
+			else { return false; }
+		}
+		data.push_back((uint8_t)value);
+	}
+	return true;
+}
+
+static bool parseNumber(string_view text, unsigned int &number)
+{
+	if (text.empty() || text.length() > 6) { return false; }
+
+	number = 0;
+	for (size_t i = 0; i < text.length(); i++)
+	{
+		if (text[i] < '0' || text[i] > '9') { return false; }
+		number = number * 10 + (text[i] - '0');
+	}
+	return true;
+}
+
+struct StoredHash
+{
+	unsigned int cost;
+	unsigned int r;
+	unsigned int p;
+	vector<uint8_t> salt;
+	vector<uint8_t> hash;
+};
+
+// "$scrypt$<cost>$<r>$<p>$<salt>$<hash>"
+static bool parseStoredHash(string_view stored, StoredHash &parsed)
+{
+	if (!isPasswordHash(stored)) { return false; }
+	stored.remove_prefix(sizeof(HASH_PREFIX) - 1);
+
+	string_view fields[5];
+	for (int i = 0; i < 5; i++)
+	{
+		size_t dollar = stored.find('$');
+		if ((dollar == string_view::npos) != (i == 4)) { return false; }
+
+		fields[i] = stored.substr(0, dollar);
+		stored = dollar == string_view::npos ? string_view() : stored.substr(dollar + 1);
+	}
+
+	return parseNumber(fields[0], parsed.cost) && parseNumber(fields[1], parsed.r) && parseNumber(fields[2], parsed.p)
+		&& fromHex(fields[3], parsed.salt) && fromHex(fields[4], parsed.hash);
+}
+
+// Compare without stopping at the first difference, so the time taken doesn't give away how much matched
+static bool equalInConstantTime(const uint8_t *a, const uint8_t *b, size_t length)
+{
+	uint8_t difference = 0;
+	for (size_t i = 0; i < length; i++) { difference |= a[i] ^ b[i]; }
+	return difference == 0;
+}
+
+std::string hashPassword(std::string_view password, unsigned int cost)
+{
+	uint8_t salt[SALT_BYTES];
+	random_device random;
+	for (size_t i = 0; i < SALT_BYTES; i++) { salt[i] = (uint8_t)random(); }
+
+	uint8_t hash[HASH_BYTES];
+	if (!scrypt((const uint8_t *)password.data(), password.length(), salt, SALT_BYTES, cost, SCRYPT_R, SCRYPT_P, hash, HASH_BYTES))
+	{
+		return "";
+	}
+
+	return string(HASH_PREFIX) + to_string(cost) + "$" + to_string(SCRYPT_R) + "$" + to_string(SCRYPT_P) + "$"
+		+ toHex(salt, SALT_BYTES) + "$" + toHex(hash, HASH_BYTES);
+}
+
+bool isPasswordHash(std::string_view stored)
+{
+	return stored.substr(0, sizeof(HASH_PREFIX) - 1) == HASH_PREFIX;
+}
+
+bool verifyPassword(std::string_view password, std::string_view stored)
+{
+	if (!isPasswordHash(stored))
+	{
+		// Old plaintext account - compare digests so it's constant time whatever the lengths
+		uint8_t attempted[32];
+		uint8_t expected[32];
+		sha256((const uint8_t *)password.data(), password.length(), attempted);
+		sha256((const uint8_t *)stored.data(), stored.length(), expected);
+		return equalInConstantTime(attempted, expected, 32);
+	}
+
+	StoredHash parsed;
+	if (!parseStoredHash(stored, parsed)) { return false; }
+
+	vector<uint8_t> hash(parsed.hash.size());
+	if (!scrypt((const uint8_t *)password.data(), password.length(), parsed.salt.data(), parsed.salt.size(),
+		parsed.cost, parsed.r, parsed.p, hash.data(), hash.size()))
+	{
+		return false;
+	}
+
+	return equalInConstantTime(hash.data(), parsed.hash.data(), hash.size());
+}
+
+bool passwordNeedsRehash(std::string_view stored, unsigned int cost)
+{
+	StoredHash parsed;
+	return !parseStoredHash(stored, parsed) || parsed.cost < cost;
+}
@@ -0,0 +1,46 @@
+#ifndef PASSWORD_HASH_H
+#define PASSWORD_HASH_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// Password hashing with scrypt (RFC 7914), built on SHA-256 / HMAC-SHA-256 / PBKDF2 - all implemented here so there's
+// nothing extra to link. scrypt is slow and needs 128 * r * 2^cost bytes of memory per hash on purpose, which makes
+// guessing passwords from a stolen userInfo.txt expensive. It's far too slow to run on the network thread, see
+// PasswordWorkers.h.
+//
+// Hashed passwords are stored as one whitespace free string, with everything needed to check them:
+//   $scrypt$<cost>$<r>$<p>$<salt as hex>$<hash as hex>
+// where cost is log2 of scrypt's N. Anything else in the accounts file is an old plaintext password.
+
+const unsigned int DEFAULT_PASSWORD_COST = 14;      // N = 16384, 16MB and somewhere around 50-100ms per hash
+const unsigned int MIN_PASSWORD_COST = 1;
+const unsigned int MAX_PASSWORD_COST = 20;
+
+// SHA-256 of data, into a 32 byte digest
+void sha256(const uint8_t *data, size_t length, uint8_t digest[32]);
+
+// PBKDF2-HMAC-SHA-256, filling output
+void pbkdf2Sha256(const uint8_t *password, size_t passwordLength, const uint8_t *salt, size_t saltLength,
+	uint64_t iterations, uint8_t *output, size_t outputLength);
+
+// scrypt with N = 2^cost. Returns false if the parameters are out of range
+bool scrypt(const uint8_t *password, size_t passwordLength, const uint8_t *salt, size_t saltLength,
+	unsigned int cost, unsigned int r, unsigned int p, uint8_t *output, size_t outputLength);
+
+// Hash a password with a fresh random salt, in the stored format above
+std::string hashPassword(std::string_view password, unsigned int cost);
+
+// Whether a stored secret is a hash (rather than an old plaintext password)
+bool isPasswordHash(std::string_view stored);
+
+// Check a password against what's stored, whether that's a hash or (for accounts made before hashing) plaintext.
+// Either way takes the same time however much of the password matches
+bool verifyPassword(std::string_view password, std::string_view stored);
+
+// Whether a stored secret should be hashed again: it's plaintext, or was hashed at a lower cost than we use now
+bool passwordNeedsRehash(std::string_view stored, unsigned int cost);
+
+#endif
@@ -0,0 +1,142 @@
+#include "PasswordWorkers.h"
+#include "PasswordHash.h"
+
+using namespace std;
+
+PasswordWorkers::PasswordWorkers(unsigned int theCost, unsigned int theMaxQueued)
+{
+	cost = theCost;
+	maxQueued = theMaxQueued;
+	lastId = 0;
+	stopping = false;
+}
+
+PasswordWorkers::~PasswordWorkers()
+{
+	stop();
+}
+
+void PasswordWorkers::start(unsigned int numWorkers, std::function<void()> theOnFinished)
+{
+	onFinished = theOnFinished;
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(thread(&PasswordWorkers::workerLoop, this));
+	}
+}
+
+void PasswordWorkers::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	jobReady.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void PasswordWorkers::workerLoop()
+{
+	while (true)
+	{
+		PasswordJob job;
+		{
+			unique_lock<mutex> guard(lock);
+			jobReady.wait(guard, [this] { return stopping || !jobs.empty(); });
+
+			if (stopping) { return; }
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		PasswordResult result;
+		run(job, cost, result);
+
+		{
+			lock_guard<mutex> guard(lock);
+			finished.push_back(std::move(result));
+		}
+
+		if (onFinished) { onFinished(); }
+	}
+}
+
+uint64_t PasswordWorkers::submit(PasswordJob &job)
+{
+	job.id = ++lastId;
+
+	if (workers.empty())
+	{
+		PasswordResult result;
+		run(job, cost, result);
+		finished.push_back(std::move(result));
+		return job.id;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		if (jobs.size() >= maxQueued) { return 0; }
+		jobs.push_back(std::move(job));
+	}
+	jobReady.notify_one();
+
+	return lastId;
+}
+
+uint64_t PasswordWorkers::submitLogin(unsigned int clientNumber, const std::string &username, const std::string &password, const std::string &stored)
+{
+	PasswordJob job;
+	job.kind = PASSWORD_LOGIN;
+	job.clientNumber = clientNumber;
+	job.username = username;
+	job.password = password;
+	job.stored = stored;
+	return submit(job);
+}
+
+uint64_t PasswordWorkers::submitSignup(unsigned int clientNumber, const std::string &username, const std::string &password)
+{
+	PasswordJob job;
+	job.kind = PASSWORD_SIGNUP;
+	job.clientNumber = clientNumber;
+	job.username = username;
+	job.password = password;
+	return submit(job);
+}
+
+void PasswordWorkers::takeFinished(std::vector<PasswordResult> &results)
+{
+	lock_guard<mutex> guard(lock);
+	results.swap(finished);
+}
+
+void PasswordWorkers::run(const PasswordJob &job, unsigned int cost, PasswordResult &result)
+{
+	result.id = job.id;
+	result.kind = job.kind;
+	result.clientNumber = job.clientNumber;
+	result.username = job.username;
+	result.newSecret.clear();
+
+	if (job.kind == PASSWORD_SIGNUP)
+	{
+		result.newSecret = hashPassword(job.password, cost);
+		result.accepted = !result.newSecret.empty();
+		return;
+	}
+
+	result.accepted = verifyPassword(job.password, job.stored);
+
+	// Plaintext accounts (and ones hashed before the cost went up) get upgraded the first time they log in
+	if (result.accepted && passwordNeedsRehash(job.stored, cost))
+	{
+		result.newSecret = hashPassword(job.password, cost);
+	}
+}
@@ -0,0 +1,87 @@
+#ifndef PASSWORD_WORKERS_H
+#define PASSWORD_WORKERS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+
+enum PasswordJobKind
+{
+	PASSWORD_LOGIN = 0,     // Check a password against the stored secret (and rehash it if it's plaintext or too cheap)
+	PASSWORD_SIGNUP = 1     // Hash a new account's password
+};
+
+struct PasswordJob
+{
+	uint64_t id;
+	uint8_t kind;
+	unsigned int clientNumber;
+	std::string username;
+	std::string password;
+	std::string stored;         // What's in the accounts file for the user (logins only)
+};
+
+struct PasswordResult
+{
+	uint64_t id;
+	uint8_t kind;
+	unsigned int clientNumber;
+	std::string username;
+	bool accepted;              // Password matched (login), or was hashed (signup)
+	std::string newSecret;      // Hash to store for the account, if it needs one (empty if not)
+};
+
+// Runs password hashing (see PasswordHash.h) on its own threads, so a login costs the network thread nothing more
+// than queueing a job and later sending the answer. Same shape as ChunkLoader: submit on the network thread, the
+// workers call onFinished when they have results, and takeFinished() picks them up.
+//
+// Each hash needs a lot of memory, so the pool's a fixed size and only so many jobs can wait for it - past that,
+// submitting fails and the player's told to try again rather than the queue growing without end.
+class PasswordWorkers
+{
+private:
+	unsigned int cost;
+	unsigned int maxQueued;
+	uint64_t lastId;
+
+	std::vector<std::thread> workers;
+	std::function<void()> onFinished;
+
+	std::mutex lock;                        // Guards jobs, finished and stopping
+	std::condition_variable jobReady;
+	std::deque<PasswordJob> jobs;
+	std::vector<PasswordResult> finished;
+	bool stopping;
+
+	void workerLoop();
+	uint64_t submit(PasswordJob &job);
+
+public:
+	PasswordWorkers(unsigned int theCost, unsigned int theMaxQueued);
+	~PasswordWorkers();
+
+	// Only change before start()
+	void setCost(unsigned int theCost) { cost = theCost; }
+	unsigned int getCost() const { return cost; }
+
+	// With no workers, jobs run there and then when they're submitted
+	void start(unsigned int numWorkers, std::function<void()> theOnFinished);
+	void stop();
+
+	// Queue a job. Returns its id (which comes back in the result), or 0 if too many jobs are waiting already
+	uint64_t submitLogin(unsigned int clientNumber, const std::string &username, const std::string &password, const std::string &stored);
+	uint64_t submitSignup(unsigned int clientNumber, const std::string &username, const std::string &password);
+
+	// Swaps everything that's finished into results (which should be empty)
+	void takeFinished(std::vector<PasswordResult> &results);
+
+	// Does the work for one job. Safe to call from any thread
+	static void run(const PasswordJob &job, unsigned int cost, PasswordResult &result);
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "PlayerDirectory.h"
+
+using namespace std;
+
+const std::string PlayerDirectory::NO_NAME;
+
+void PlayerDirectory::setName(unsigned int clientNumber, const std::string &username)
+{
+	clear(clientNumber);
+
+	if (username.empty()) { return; }
+
+	if (clientNumber >= names.size()) { names.resize(clientNumber + 1); }
+	names[clientNumber] = username;
+	slots[username] = clientNumber;
+}
+
+void PlayerDirectory::clear(unsigned int clientNumber)
+{
+	if (clientNumber >= names.size()) { return; }
+
+	string &name = names[clientNumber];
+	if (name.empty()) { return; }
+
+	// Only forget the username if it's still ours (it may have moved to another slot since)
+	unordered_map<string, unsigned int>::iterator it = slots.find(name);
+	if (it != slots.end() && it->second == clientNumber) { slots.erase(it); }
+
+	name.clear();
+}
+
+int PlayerDirectory::findSlot(std::string_view username) const
+{
+	unordered_map<string, unsigned int>::const_iterator it = slots.find(string(username));
+	return it == slots.end() ? NO_PLAYER : (int)it->second;
+}
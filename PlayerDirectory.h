@@ -0,0 +1,39 @@
+#ifndef PLAYER_DIRECTORY_H
+#define PLAYER_DIRECTORY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+// Who's playing in each client slot, and which slot each player's in, both kept up to date as players join and
+// leave so either way round is a single lookup (rather than checking every slot for a username).
+class PlayerDirectory
+{
+private:
+	std::vector<std::string> names;                        // By client slot ("" for slots without a player), grows as needed
+	std::unordered_map<std::string, unsigned int> slots;   // By username
+
+public:
+	static const int NO_PLAYER = -1;
+	static const std::string NO_NAME;
+
+	// Give a client slot a player (replacing whoever was in it). A username that's already in use by another slot
+	// is moved over to this one
+	void setName(unsigned int clientNumber, const std::string &username);
+
+	// The slot's player has gone
+	void clear(unsigned int clientNumber);
+
+	// The slot's player, or NO_NAME ("") if there isn't one
+	const std::string &getName(unsigned int clientNumber) const { return clientNumber < names.size() ? names[clientNumber] : NO_NAME; }
+	bool hasName(unsigned int clientNumber) const { return clientNumber < names.size() && !names[clientNumber].empty(); }
+
+	// The client slot a player is in, or NO_PLAYER if they're not on
+	int findSlot(std::string_view username) const;
+	bool isOnline(std::string_view username) const { return findSlot(username) != NO_PLAYER; }
+
+	unsigned int size() const { return (unsigned int)slots.size(); }
+};
+
+#endif
@@ -0,0 +1,366 @@
+#include "RegionFile.h"
+#include "Chunk.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char REGION_MAGIC[4] = { 'S', 'R', 'G', 'N' };
+
+struct RegionHeader
+{
+	char magic[4];
+	uint32_t version;
+	int32_t regionX;
+	int32_t regionY;
+};
+
+struct RegionIndexEntry
+{
+	uint32_t firstRecord;
+	uint32_t count;
+};
+
+static const size_t REGION_INDEX_OFFSET = sizeof(RegionHeader);
+static const size_t REGION_RECORDS_OFFSET = REGION_INDEX_OFFSET + REGION_CHUNKS * sizeof(RegionIndexEntry);
+
+// The file is read straight out of memory, so the structs have to match the layout exactly
+static_assert(sizeof(RegionHeader) == 16, "RegionHeader must be 16 bytes");
+static_assert(sizeof(RegionIndexEntry) == 8, "RegionIndexEntry must be 8 bytes");
+static_assert(sizeof(PlanetRecord) == 28, "PlanetRecord must be 28 bytes");
+
+// Where a chunk's entry is in its region's index
+static int chunkSlot(int chunkX, int chunkY)
+{
+	int localX = chunkX - regionOf(chunkX) * REGION_SIZE;
+	int localY = chunkY - regionOf(chunkY) * REGION_SIZE;
+	return localY * REGION_SIZE + localX;
+}
+
+RegionFile::RegionFile()
+{
+	data = NULL;
+	size = 0;
+	regionX = 0;
+	regionY = 0;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = NULL;
+#endif
+}
+
+RegionFile::~RegionFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool RegionFile::open(const std::string &fileName)
+{
+	close();
+
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < (LONGLONG)REGION_RECORDS_OFFSET)
+	{
+		unmap();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL)
+	{
+		unmap();
+		return false;
+	}
+
+	data = (const char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)fileSize.QuadPart;
+
+#else
+
+bool RegionFile::open(const std::string &fileName)
+{
+	close();
+
+	int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) { return false; }
+
+	struct stat fileInfo;
+	if (fstat(fd, &fileInfo) == -1 || fileInfo.st_size < (off_t)REGION_RECORDS_OFFSET)
+	{
+		::close(fd);
+		return false;
+	}
+
+	// The mapping keeps the file alive on its own, so the descriptor can go straight away
+	void *mapping = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (mapping != MAP_FAILED)
+	{
+		data = (const char *)mapping;
+		size = (size_t)fileInfo.st_size;
+	}
+
+#endif
+
+	if (data == NULL)
+	{
+		unmap();
+		return false;
+	}
+
+	// Check the whole index up front, so findChunk() can trust it
+	const RegionHeader *header = (const RegionHeader *)data;
+	bool valid = memcmp(header->magic, REGION_MAGIC, sizeof(REGION_MAGIC)) == 0 && header->version == REGION_VERSION;
+
+	const RegionIndexEntry *index = (const RegionIndexEntry *)(data + REGION_INDEX_OFFSET);
+	uint64_t numRecords = (size - REGION_RECORDS_OFFSET) / sizeof(PlanetRecord);
+
+	for (int i = 0; valid && i < REGION_CHUNKS; i++)
+	{
+		if (index[i].firstRecord != REGION_NO_CHUNK && (uint64_t)index[i].firstRecord + index[i].count > numRecords)
+		{
+			valid = false;
+		}
+	}
+
+	if (!valid)
+	{
+		cerr << "Ignoring broken region file " << fileName << endl;
+		unmap();
+		return false;
+	}
+
+	regionX = header->regionX;
+	regionY = header->regionY;
+	return true;
+}
+
+void RegionFile::unmap()
+{
+#ifdef _WIN32
+	if (data != NULL) { UnmapViewOfFile(data); }
+	if (mappingHandle != NULL) { CloseHandle(mappingHandle); }
+	if (fileHandle != INVALID_HANDLE_VALUE) { CloseHandle(fileHandle); }
+	mappingHandle = NULL;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data != NULL) { munmap((void *)data, size); }
+#endif
+
+	data = NULL;
+	size = 0;
+}
+
+void RegionFile::close()
+{
+	unmap();
+}
+
+bool RegionFile::findChunk(int chunkX, int chunkY, const PlanetRecord *&records, unsigned int &count) const
+{
+	if (data == NULL || regionOf(chunkX) != regionX || regionOf(chunkY) != regionY) { return false; }
+
+	const RegionIndexEntry &entry = ((const RegionIndexEntry *)(data + REGION_INDEX_OFFSET))[chunkSlot(chunkX, chunkY)];
+	if (entry.firstRecord == REGION_NO_CHUNK) { return false; }
+
+	records = (const PlanetRecord *)(data + REGION_RECORDS_OFFSET) + entry.firstRecord;
+	count = entry.count;
+	return true;
+}
+
+bool RegionFile::write(const std::string &fileName, int regionX, int regionY, const std::map<int, std::vector<Planet>> &chunks)
+{
+	RegionHeader header;
+	memcpy(header.magic, REGION_MAGIC, sizeof(REGION_MAGIC));
+	header.version = REGION_VERSION;
+	header.regionX = regionX;
+	header.regionY = regionY;
+
+	vector<RegionIndexEntry> index(REGION_CHUNKS);
+	for (int i = 0; i < REGION_CHUNKS; i++)
+	{
+		index[i].firstRecord = REGION_NO_CHUNK;
+		index[i].count = 0;
+	}
+
+	vector<PlanetRecord> records;
+	for (map<int, vector<Planet>>::const_iterator it = chunks.begin(); it != chunks.end(); ++it)
+	{
+		if (it->first < 0 || it->first >= REGION_CHUNKS) { continue; }
+
+		index[it->first].firstRecord = (uint32_t)records.size();
+		index[it->first].count = (uint32_t)it->second.size();
+
+		for (unsigned int i = 0; i < it->second.size(); i++)
+		{
+			const Planet &planet = it->second[i];
+			PlanetRecord record = { planet.x, planet.y, planet.diameter, planet.r, planet.g, planet.b, planet.image };
+			records.push_back(record);
+		}
+	}
+
+	// Write to a temporary file and swap it in, so a server reading the old one never sees half a file
+	string tempName = fileName + ".tmp";
+	{
+		ofstream out(tempName, ios::binary | ios::trunc);
+		if (!out.good()) { return false; }
+
+		out.write((const char *)&header, sizeof(header));
+		out.write((const char *)index.data(), index.size() * sizeof(RegionIndexEntry));
+		out.write((const char *)records.data(), records.size() * sizeof(PlanetRecord));
+
+		if (!out.good()) { return false; }
+	}
+
+	error_code error;
+	filesystem::rename(tempName, fileName, error);
+	return !error;
+}
+
+RegionStore::RegionStore(const std::string &theDirectory)
+{
+	directory = theDirectory;
+}
+
+std::string RegionStore::fileNameFor(const std::string &directory, int regionX, int regionY)
+{
+	return directory + "/" + to_string(regionX) + "," + to_string(regionY) + ".region";
+}
+
+bool RegionStore::findChunk(int chunkX, int chunkY, const PlanetRecord *&records, unsigned int &count)
+{
+	int regionX = regionOf(chunkX);
+	int regionY = regionOf(chunkY);
+
+	RegionFile *region;
+	{
+		lock_guard<mutex> guard(lock);
+
+		int64_t key = chunkKey(regionX, regionY);
+		unordered_map<int64_t, unique_ptr<RegionFile>>::iterator it = regions.find(key);
+
+		// Only try opening each region once - most of the universe has never been saved, and that's fine
+		if (it == regions.end())
+		{
+			unique_ptr<RegionFile> file(new RegionFile());
+			if (!file->open(fileNameFor(directory, regionX, regionY))) { file.reset(); }
+
+			it = regions.emplace(key, std::move(file)).first;
+		}
+
+		region = it->second.get();
+	}
+
+	return region != NULL && region->findChunk(chunkX, chunkY, records, count);
+}
+
+// Chunk files are named "<x>,<y>~.txt"
+static bool parseChunkFileName(const string &name, int &chunkX, int &chunkY)
+{
+	char tail[8] = { 0 };
+	return sscanf(name.c_str(), "%d,%d%7s", &chunkX, &chunkY, tail) == 3 && string(tail) == "~.txt";
+}
+
+int convertChunkFiles(const std::string &chunkDirectory, const std::string &regionDirectory)
+{
+	error_code error;
+	if (!filesystem::is_directory(chunkDirectory, error))
+	{
+		cerr << "No chunk directory at " << chunkDirectory << endl;
+		return -1;
+	}
+
+	filesystem::create_directories(regionDirectory, error);
+	if (error)
+	{
+		cerr << "Couldn't create " << regionDirectory << ": " << error.message() << endl;
+		return -1;
+	}
+
+	// Gather every chunk file, grouped by the region it's going in
+	map<int64_t, map<int, vector<Planet>>> converted;
+	unsigned int numChunks = 0;
+	unsigned int numSkipped = 0;
+
+	for (filesystem::directory_iterator it(chunkDirectory, error), end; !error && it != end; it.increment(error))
+	{
+		int chunkX;
+		int chunkY;
+		string name = it->path().filename().string();
+
+		if (!parseChunkFileName(name, chunkX, chunkY)) { continue; }
+
+		vector<Planet> planets;
+		if (!isValidChunk(chunkX, chunkY) || !readChunkFile(it->path().string(), planets))
+		{
+			cerr << "Skipping " << name << endl;
+			numSkipped++;
+			continue;
+		}
+
+		converted[chunkKey(regionOf(chunkX), regionOf(chunkY))][chunkSlot(chunkX, chunkY)] = planets;
+		numChunks++;
+	}
+
+	for (map<int64_t, map<int, vector<Planet>>>::iterator it = converted.begin(); it != converted.end(); ++it)
+	{
+		int regionX = chunkKeyX(it->first);
+		int regionY = chunkKeyY(it->first);
+		string fileName = RegionStore::fileNameFor(regionDirectory, regionX, regionY);
+
+		// Keep whatever's already saved in the region, unless a text file replaces it
+		RegionFile existing;
+		if (existing.open(fileName))
+		{
+			for (int slot = 0; slot < REGION_CHUNKS; slot++)
+			{
+				int chunkX = regionX * REGION_SIZE + slot % REGION_SIZE;
+				int chunkY = regionY * REGION_SIZE + slot / REGION_SIZE;
+				const PlanetRecord *records;
+				unsigned int count;
+
+				if (it->second.count(slot) == 0 && existing.findChunk(chunkX, chunkY, records, count))
+				{
+					vector<Planet> &planets = it->second[slot];
+					for (unsigned int i = 0; i < count; i++)
+					{
+						Planet planet = { records[i].x, records[i].y, records[i].diameter, records[i].r, records[i].g, records[i].b, records[i].image };
+						planets.push_back(planet);
+					}
+				}
+			}
+			existing.close();
+		}
+
+		if (!RegionFile::write(fileName, regionX, regionY, it->second))
+		{
+			cerr << "Couldn't write " << fileName << endl;
+			return -1;
+		}
+	}
+
+	cout << "Converted " << numChunks << " chunk files into " << converted.size() << " region files in " << regionDirectory;
+	if (numSkipped > 0) { cout << " (skipped " << numSkipped << ")"; }
+	cout << endl;
+
+	return 0;
+}
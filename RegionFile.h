@@ -0,0 +1,103 @@
+#ifndef REGION_FILE_H
+#define REGION_FILE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include "ChunkGenerator.h"
+
+// Saved chunks are packed into region files of REGION_SIZE x REGION_SIZE chunks each, rather than one text file per
+// chunk. A region file is memory mapped, so reading a chunk is an index lookup and a pointer into the mapping - no
+// path building, no open() and no parsing.
+//
+// Layout (all numbers are 32 bit little endian):
+//   header  "SRGN", version, regionX, regionY
+//   index   REGION_CHUNKS entries of (first record, record count), in row order (y * REGION_SIZE + x within the
+//           region). A first record of REGION_NO_CHUNK means the chunk isn't saved and comes from the generator
+//   records one PlanetRecord per planet, each chunk's planets one after another
+const int REGION_SIZE = 32;
+const int REGION_CHUNKS = REGION_SIZE * REGION_SIZE;
+const uint32_t REGION_VERSION = 1;
+const uint32_t REGION_NO_CHUNK = 0xFFFFFFFF;
+
+// One planet as it's stored in a region file (the same numbers as Planet, but always 32 bits each)
+struct PlanetRecord
+{
+	int32_t x;
+	int32_t y;
+	int32_t diameter;
+	int32_t r;
+	int32_t g;
+	int32_t b;
+	int32_t image;
+};
+
+// Which region a chunk is in (rounding down, like chunkOf())
+inline int regionOf(int chunk)
+{
+	return chunk >= 0 ? chunk / REGION_SIZE : -((-(chunk + 1)) / REGION_SIZE) - 1;
+}
+
+// A read-only region file, mapped into memory for as long as the object's alive
+class RegionFile
+{
+private:
+	const char *data;
+	size_t size;
+	int regionX;
+	int regionY;
+
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#endif
+
+	void unmap();
+
+public:
+	RegionFile();
+	~RegionFile();
+
+	// Map a region file and check its header and index. Returns false (and leaves nothing mapped) if the file's
+	// missing or broken
+	bool open(const std::string &fileName);
+	void close();
+
+	int getRegionX() const { return regionX; }
+	int getRegionY() const { return regionY; }
+
+	// Point records at a chunk's planets (inside the mapping). Returns false if the chunk isn't in the file
+	bool findChunk(int chunkX, int chunkY, const PlanetRecord *&records, unsigned int &count) const;
+
+	// Write a whole region file from scratch. chunks is keyed on the chunk's index within the region
+	static bool write(const std::string &fileName, int regionX, int regionY, const std::map<int, std::vector<Planet>> &chunks);
+};
+
+// Every region file in a directory, opened the first time one of its chunks is asked for and kept open after that.
+// Safe to use from the chunk workers - the lock is only held while finding the region, not while reading it.
+class RegionStore
+{
+private:
+	std::string directory;
+
+	std::mutex lock;
+	std::unordered_map<int64_t, std::unique_ptr<RegionFile>> regions;    // Regions without a file are stored as null
+
+public:
+	RegionStore(const std::string &theDirectory);
+
+	// Same as RegionFile::findChunk, for any chunk. The records stay valid for as long as the store's alive
+	bool findChunk(int chunkX, int chunkY, const PlanetRecord *&records, unsigned int &count);
+
+	static std::string fileNameFor(const std::string &directory, int regionX, int regionY);
+};
+
+// One-shot conversion of the old one-text-file-per-chunk saves ("<x>,<y>~.txt") into region files. Chunks already in
+// a region file are kept unless there's a text file for them too. Returns 0 on success, like main()
+int convertChunkFiles(const std::string &chunkDirectory, const std::string &regionDirectory);
+
+#endif
@@ -0,0 +1,160 @@
+#include "RegionSimulation.h"
+
+using namespace std;
+
+RegionSimulation::RegionSimulation()
+{
+	lastShotId = 0;
+	handoffs = 0;
+}
+
+void RegionSimulation::start(unsigned int numThreads)
+{
+	workers.start(numThreads);
+}
+
+void RegionSimulation::stop()
+{
+	workers.stop();
+}
+
+uint8_t RegionSimulation::registerType(const std::string &name, double lifetimeSeconds)
+{
+	typeNames.push_back(name);
+	typeLifetime.push_back(lifetimeSeconds);
+
+	for (unsigned int i = 0; i < regionList.size(); i++)
+	{
+		regionList[i]->shots.registerType(name, lifetimeSeconds);
+	}
+
+	return (uint8_t)(typeNames.size() - 1);
+}
+
+int RegionSimulation::findType(const std::string &name) const
+{
+	for (unsigned int i = 0; i < typeNames.size(); i++)
+	{
+		if (typeNames[i] == name) { return (int)i; }
+	}
+	return -1;
+}
+
+RegionSimulation::SimRegion &RegionSimulation::regionAt(double x, double y)
+{
+	int64_t key = chunkKey(simRegionOf(x), simRegionOf(y));
+
+	unordered_map<int64_t, unique_ptr<SimRegion>>::iterator found = regions.find(key);
+	if (found != regions.end()) { return *found->second; }
+
+	unique_ptr<SimRegion> region(new SimRegion());
+	region->key = key;
+	for (unsigned int i = 0; i < typeNames.size(); i++)
+	{
+		region->shots.registerType(typeNames[i], typeLifetime[i]);
+	}
+
+	regionList.push_back(region.get());
+	return *regions.emplace(key, std::move(region)).first->second;
+}
+
+uint32_t RegionSimulation::spawn(uint8_t typeId, uint32_t ownerId, double startX, double startY, int startRotation, double startVelocityX, double startVelocityY)
+{
+	// Ids are handed out here rather than by the regions' stores, so they're unique across all of them
+	lastShotId++;
+	if (lastShotId == NO_SHOT) { lastShotId = 1; }
+
+	SimRegion &region = regionAt(startX, startY);
+	if (region.shots.spawn(typeId, ownerId, startX, startY, startRotation, startVelocityX, startVelocityY, lastShotId) == NO_SHOT)
+	{
+		return NO_SHOT;
+	}
+
+	return lastShotId;
+}
+
+// One region's tick, run on a worker. Only touches the region itself (and pushes onto the handoff queue)
+void RegionSimulation::tickRegion(SimRegion &region, double elapsedSeconds, const CollisionWorld &world)
+{
+	ShotStore &shots = region.shots;
+
+	shots.integrate(elapsedSeconds);
+
+	// Shots that hit a ship or planet are done with, and so are ones that have run out of time
+	region.events.clear();
+	world.findHits(shots, region.events);
+
+	for (unsigned int i = 0; i < region.events.size(); i++)
+	{
+		shots.remove(region.events[i].shot);
+	}
+
+	shots.expire(region.events);
+
+	// Anything that's flown out of the region goes to whichever region it's in now. Walk backwards, so the shot
+	// swapped into a hole has already been looked at
+	for (unsigned int i = shots.size(); i-- > 0; )
+	{
+		if (chunkKey(simRegionOf(shots.getX(i)), simRegionOf(shots.getY(i))) == region.key) { continue; }
+
+		ShotHandoff handoff;
+		handoff.id = shots.getId(i);
+		handoff.type = shots.getType(i);
+		handoff.owner = shots.getOwner(i);
+		handoff.x = shots.getX(i);
+		handoff.y = shots.getY(i);
+		handoff.velocityX = shots.getVelocityX(i);
+		handoff.velocityY = shots.getVelocityY(i);
+		handoff.age = shots.getAge(i);
+		handoff.rotation = shots.getRotation(i);
+		handoffQueue.push(handoff);
+
+		shots.remove(shots.getHandle(i));
+	}
+}
+
+void RegionSimulation::tick(double elapsedSeconds, CollisionWorld &world, std::vector<ShotEvent> &events)
+{
+	world.sortShips();
+
+	const CollisionWorld &readOnlyWorld = world;
+	workers.run((unsigned int)regionList.size(), [this, elapsedSeconds, &readOnlyWorld](unsigned int i) {
+		tickRegion(*regionList[i], elapsedSeconds, readOnlyWorld);
+	});
+
+	for (unsigned int i = 0; i < regionList.size(); i++)
+	{
+		events.insert(events.end(), regionList[i]->events.begin(), regionList[i]->events.end());
+	}
+
+	// Every worker's finished pushing by now, so this gets all of them
+	ShotHandoff handoff;
+	while (handoffQueue.pop(handoff))
+	{
+		SimRegion &region = regionAt(handoff.x, handoff.y);
+		region.shots.spawn(handoff.type, handoff.owner, handoff.x, handoff.y, handoff.rotation, handoff.velocityX, handoff.velocityY,
+			handoff.id, handoff.age);
+		handoffs++;
+	}
+
+	// Drop regions nothing's flying in any more
+	for (unsigned int i = (unsigned int)regionList.size(); i-- > 0; )
+	{
+		if (regionList[i]->shots.size() > 0) { continue; }
+
+		int64_t key = regionList[i]->key;
+		regionList[i] = regionList.back();
+		regionList.pop_back();
+		regions.erase(key);
+	}
+}
+
+unsigned int RegionSimulation::size() const
+{
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < regionList.size(); i++)
+	{
+		total += regionList[i]->shots.size();
+	}
+	return total;
+}
@@ -0,0 +1,106 @@
+#ifndef REGION_SIMULATION_H
+#define REGION_SIMULATION_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "Chunk.h"
+#include "ShotStore.h"
+#include "CollisionWorld.h"
+#include "MpscQueue.h"
+#include "WorkerGroup.h"
+
+// Simulation regions are square blocks of this many chunks across
+const int SIM_REGION_CHUNKS = 4;
+
+// Which simulation region a world coordinate falls in (rounding down, like chunkOf)
+inline int simRegionOf(double worldCoordinate)
+{
+	return (int)std::floor(worldCoordinate / ((double)CHUNK_SIZE * SIM_REGION_CHUNKS));
+}
+
+// A shot on its way from one region to another, with everything needed to carry on flying it there
+struct ShotHandoff
+{
+	uint32_t id;
+	uint8_t type;
+	uint32_t owner;
+	double x;
+	double y;
+	double velocityX;
+	double velocityY;
+	double age;
+	int rotation;
+};
+
+// Every live shot, split up by where it is into regions of SIM_REGION_CHUNKS x SIM_REGION_CHUNKS chunks, each with its
+// own ShotStore. A tick runs each region's shots (move, test against the ships and planets, expire) as a separate job
+// on a WorkerGroup, so players spread over the map keep every core busy while nothing's shared between regions but
+// the read-only CollisionWorld.
+//
+// A shot that flies out of its region is taken out of that region's store and pushed onto a lock-free queue by
+// whichever worker ran it; once the tick's done the queue's drained and the shot's put into the region it's moved
+// to, keeping its id and age, so clients never see the difference. Regions are made as shots arrive in them and
+// dropped once they're empty.
+class RegionSimulation
+{
+private:
+	struct SimRegion
+	{
+		int64_t key;
+		ShotStore shots;
+		std::vector<ShotEvent> events;      // What happened to its shots this tick
+	};
+
+	std::unordered_map<int64_t, std::unique_ptr<SimRegion>> regions;
+	std::vector<SimRegion *> regionList;    // The same regions, as a list the workers can split up
+
+	// Shot types, registered with each region's store as it's made
+	std::vector<std::string> typeNames;
+	std::vector<double> typeLifetime;
+
+	uint32_t lastShotId;
+	unsigned long long handoffs;
+
+	WorkerGroup workers;
+	MpscQueue<ShotHandoff> handoffQueue;    // Shots that left their region this tick
+
+	SimRegion &regionAt(double x, double y);
+	void tickRegion(SimRegion &region, double elapsedSeconds, const CollisionWorld &world);
+
+public:
+	RegionSimulation();
+
+	// With no threads every region's run on the calling thread
+	void start(unsigned int numThreads);
+	void stop();
+
+	// Add a kind of shot. Returns its type id
+	uint8_t registerType(const std::string &name, double lifetimeSeconds);
+
+	// Returns the type id for a name, or -1 if there's no such type
+	int findType(const std::string &name) const;
+	const std::string &getTypeName(uint8_t typeId) const { return typeNames[typeId]; }
+
+	// Add a shot to whichever region it's in. Returns the shot's id (which is what clients know it by), or NO_SHOT if
+	// its region is full
+	uint32_t spawn(uint8_t typeId, uint32_t ownerId, double startX, double startY, int startRotation, double startVelocityX, double startVelocityY);
+
+	// Move every shot on by elapsedSeconds, adding an event to events for each one that hit something (and removing
+	// it), then for each one that's expired. Sorts the world's ships first, and doesn't change it otherwise
+	void tick(double elapsedSeconds, CollisionWorld &world, std::vector<ShotEvent> &events);
+
+	// The regions, for walking every shot
+	unsigned int getRegionCount() const { return (unsigned int)regionList.size(); }
+	const ShotStore &getRegionShots(unsigned int i) const { return regionList[i]->shots; }
+
+	// Shots in every region
+	unsigned int size() const;
+
+	// How many shots have moved from one region to another
+	unsigned long long getHandoffCount() const { return handoffs; }
+};
+
+#endif
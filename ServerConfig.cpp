@@ -0,0 +1,91 @@
+#include "ServerConfig.h"
+#include "PasswordHash.h"
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+ServerConfig::ServerConfig()
+{
+	port = 0;
+	maxClients = 1000;
+	tickRate = 30;
+	maxCatchUpTicks = 5;
+	statsInterval = 0;
+	chunkCacheSize = 1024;
+	worldSeed = 1;
+	planetsPerChunk = 10;
+	planetSpacing = 2000;
+	acceptorThreads = 0;
+	udpChannels = 1;
+	chunkWorkers = 2;
+	prefetchChunks = 1;
+	prefetchSeconds = 2;
+	pushChunks = 0;
+	simulationThreads = 2;
+	passwordWorkers = 2;
+	passwordCost = DEFAULT_PASSWORD_COST;
+}
+
+// Trim spaces and tabs from both ends
+static string trim(const string &text)
+{
+	size_t start = text.find_first_not_of(" \t\r");
+	if (start == string::npos) { return ""; }
+
+	size_t end = text.find_last_not_of(" \t\r");
+	return text.substr(start, end - start + 1);
+}
+
+bool ServerConfig::load(const string &fileName)
+{
+	ifstream in(fileName);
+	if (!in.good()) { return false; }
+
+	string line;
+	while (getline(in, line))
+	{
+		line = line.substr(0, line.find('#'));
+
+		size_t equals = line.find('=');
+		if (equals == string::npos) { continue; }
+
+		string name = trim(line.substr(0, equals));
+		string value = trim(line.substr(equals + 1));
+		unsigned long number = strtoul(value.c_str(), NULL, 10);
+
+		if (name == "port") { port = number; }
+		else if (name == "max_clients") { maxClients = number; }
+		else if (name == "tick_rate") { tickRate = number; }
+		else if (name == "max_catch_up_ticks") { maxCatchUpTicks = number; }
+		else if (name == "stats_interval") { statsInterval = number; }
+		else if (name == "chunk_cache_size") { chunkCacheSize = number; }
+		else if (name == "world_seed") { worldSeed = number; }
+		else if (name == "planets_per_chunk") { planetsPerChunk = number; }
+		else if (name == "planet_spacing") { planetSpacing = number; }
+		else if (name == "acceptor_threads") { acceptorThreads = number; }
+		else if (name == "udp_channels") { udpChannels = number; }
+		else if (name == "chunk_workers") { chunkWorkers = number; }
+		else if (name == "prefetch_chunks") { prefetchChunks = number; }
+		else if (name == "prefetch_seconds") { prefetchSeconds = number; }
+		else if (name == "push_chunks") { pushChunks = number; }
+		else if (name == "simulation_threads") { simulationThreads = number; }
+		else if (name == "password_workers") { passwordWorkers = number; }
+		else if (name == "password_cost") { passwordCost = number; }
+		else if (!name.empty()) { cerr << "Unknown setting in " << fileName << ": " << name << endl; }
+	}
+
+	// A tick rate of zero would never tick at all
+	if (tickRate == 0) { tickRate = 1; }
+	if (maxCatchUpTicks == 0) { maxCatchUpTicks = 1; }
+	if (maxClients == 0) { maxClients = 1; }
+
+	if (passwordCost < MIN_PASSWORD_COST || passwordCost > MAX_PASSWORD_COST)
+	{
+		cerr << "password_cost has to be between " << MIN_PASSWORD_COST << " and " << MAX_PASSWORD_COST << ", using " << DEFAULT_PASSWORD_COST << endl;
+		passwordCost = DEFAULT_PASSWORD_COST;
+	}
+
+	return true;
+}
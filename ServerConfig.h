@@ -0,0 +1,36 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <string>
+
+// Server settings, read from data/server.cfg. Each line is "name = value", and anything after a '#' is a comment.
+// Settings missing from the file keep the defaults set in the constructor.
+class ServerConfig
+{
+public:
+	unsigned int port;              // Port to listen on (0 means ask at startup)
+	unsigned int maxClients;        // Most clients connected at once (anyone past that is told the server's full)
+	unsigned int tickRate;          // Simulation ticks per second (i.e. 20, 30, 60)
+	unsigned int maxCatchUpTicks;   // Most ticks we'll run back to back after a stall before skipping the rest
+	unsigned int statsInterval;     // Seconds between tick timing reports (0 turns them off)
+	unsigned int chunkCacheSize;    // Most chunks kept in memory ready to send
+	unsigned int worldSeed;         // Seed every chunk is generated from (changing it changes the whole universe)
+	unsigned int planetsPerChunk;   // Planets the generator tries to fit in each chunk
+	unsigned int planetSpacing;     // Smallest gap between the edges of two planets
+	unsigned int acceptorThreads;   // Threads accepting connections, each on its own SO_REUSEPORT listener (0 accepts on the network thread)
+	unsigned int udpChannels;       // Let clients have a UDP channel for positions and shots (0 or 1)
+	unsigned int chunkWorkers;      // Threads loading and generating chunks (0 does it on the network thread)
+	unsigned int prefetchChunks;    // Load the chunks around and ahead of each player before they're asked for (0 or 1)
+	unsigned int prefetchSeconds;   // How far ahead (in seconds at the player's current speed) to look
+	unsigned int pushChunks;        // Send prefetched chunks to players without waiting for them to ask (0 or 1)
+	unsigned int simulationThreads; // Threads simulating shots alongside the network thread (0 does it all on the network thread)
+	unsigned int passwordWorkers;   // Threads hashing and checking passwords (0 does it on the network thread)
+	unsigned int passwordCost;      // scrypt cost (log2 N) for new password hashes, see PasswordHash.h
+
+	ServerConfig();
+
+	// Returns false if the file couldn't be opened (the defaults are left in place)
+	bool load(const std::string &fileName);
+};
+
+#endif
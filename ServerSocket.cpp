@@ -1,122 +1,84 @@
 #include "ServerSocket.h"
+#include "PasswordHash.h"
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include <cmath>
 #include <ctime>
+#include <cstdlib>
+#include <algorithm>
 // Static constants for the ServerSocket class
 const string ServerSocket::SERVER_NOT_FULL = "OK";
 const string ServerSocket::SERVER_FULL = "FULL";
 const string ServerSocket::SHUTDOWN_SIGNAL = "/shutdown";
+const unsigned int ServerSocket::MAX_MESSAGE_SIZE = 64 * 1024;
+const unsigned int ServerSocket::OUTBOUND_HIGH_WATER = 1024 * 1024;
+const unsigned int ServerSocket::DEFAULT_CHUNK_CACHE_SIZE = 1024;
+const unsigned int ServerSocket::DEFAULT_WORLD_SEED = 1;
+const unsigned int ServerSocket::DEFAULT_PLANETS_PER_CHUNK = 10;
+const unsigned int ServerSocket::DEFAULT_PLANET_SPACING = 2000;
+const unsigned int ServerSocket::DEFAULT_PREFETCH_SECONDS = 2;
+const unsigned int ServerSocket::INITIAL_SESSIONS = 128;
+
+// Logins and signups waiting for a password worker before we start turning them away
+static const unsigned int MAX_QUEUED_PASSWORD_JOBS = 64;
+
+// Clients send shot velocities in units per frame, and run at this many frames per second
+static const double CLIENT_FRAMES_PER_SECOND = 60;
+
+// Shots are re-sent every tick for this long after being fired, to make sure every client gets them
+static const double SHOT_RESEND_SECONDS = 0.16;
 
 using namespace std;
 
 // ServerSocket constructor
 ServerSocket::ServerSocket(unsigned int thePort, unsigned int theBufferSize, unsigned int theMaxSockets)
+	: chunkCache(DEFAULT_CHUNK_CACHE_SIZE), chunkLoader(DEFAULT_WORLD_SEED, DEFAULT_PLANETS_PER_CHUNK, DEFAULT_PLANET_SPACING), prefetcher(DEFAULT_PREFETCH_SECONDS), passwordWorkers(DEFAULT_PASSWORD_COST, MAX_QUEUED_PASSWORD_JOBS)
 {
 	debug = false; // Flag to control whether to output debug info
 	shutdownServer = false; // Flag to control whether it's time to shut down the server
+	prefetchEnabled = true;
+	udpOpen = false;
+
+	// UDP tokens are what stop anyone else taking over a client's channel, so they need to be hard to guess
+	std::random_device seed;
+	udpTokenSource.seed(((uint64_t)seed() << 32) | seed());
+	pushPrefetched = false;
 
 	port = thePort;                      // The port number on the server we're connecting to
-	bufferSize = theBufferSize;                // The maximum size of a message
+	bufferSize = theBufferSize;                // The initial size of each client's receive buffer
 	maxSockets = theMaxSockets;                // Maximum number of sockets in our socket set
 	maxClients = theMaxSockets - 1;            // Maximum number of clients who can connect to the server
 
-	pClientSocket = new TCPsocket[maxClients]; // Create the array to the client sockets
-	pSocketIsFree = new bool[maxClients];      // Create the array to the client socket free status'
-	pBuffer = new char[bufferSize];            // Create the transmission buffer character array
-
 	clientCount = 0;     // Initially we have zero clients...
 
-	//setting initial playerList to ""
-	for (int i = 0; i < maxSockets; i++) {
-		playerList[i] = "";
+	// The session table starts off empty and gets a new entry whenever everyone already in it is connected, so a
+	// server allowed thousands of clients only has as many sessions as it's ever had clients at once
+	sessions.reserve(std::min(maxClients, INITIAL_SESSIONS));
 
-	}
+	// Kinds of shot we know about, and how long (in seconds) each one flies for before expiring
+	shots.registerType("blaster", 1.5);
 
-	// Create the socket set with enough space to store our desired number of connections (i.e. sockets)
-	socketSet = SDLNet_AllocSocketSet(maxSockets);
-	if (socketSet == NULL)
-	{
-		string msg = "Failed to allocate the socket set: ";
-		msg += SDLNet_GetError();
+	// Set up the table of "!command" handlers
+	commands.add("frame", &ServerSocket::handleFrame);
+	commands.add("proto", &ServerSocket::handleProto);
+	commands.add("use", &ServerSocket::handleUse);
+	commands.add("shoot", &ServerSocket::handleShoot);
+	commands.add("loadchunk", &ServerSocket::handleLoadChunk);
+	commands.add("pos", &ServerSocket::handlePosition);
+	commands.add("logt", &ServerSocket::handleLogin);
+	commands.add("signup", &ServerSocket::handleSignup);
+	commands.add("udp", &ServerSocket::handleUdp);
+	commands.add("ack", &ServerSocket::handleAck);
 
-		SocketException e(msg);
-		throw e;
-	}
-	else
-	{
-		if (debug)
-		{
-			cout << "Allocated socket set size: " << maxSockets << ", of which " << maxClients << " are free." << endl;
-		}
-	}
-
-	// Initialize all the client sockets (i.e. blank them ready for use!)
-	for (unsigned int loop = 0; loop < maxClients; loop++)
-	{
-		pClientSocket[loop] = NULL;
-		pSocketIsFree[loop] = true; // Set all our sockets to be free (i.e. available for use for new client connections)
-	}
+	// Open the listening socket on the provided port number and start watching it for incoming connections
+	pReactor = new EventReactor(port, maxSockets);
 
-	// Try to resolve the provided server hostname to an IP address.
-	// If successful, this places the connection details in the serverIP object and creates a listening port on the
-	// provided port number.
-	// Note: Passing the second parameter as "NULL" means "make a listening port". SDLNet_ResolveHost returns one of two
-	// values: -1 if resolving failed, and 0 if resolving was successful
-	int hostResolved = SDLNet_ResolveHost(&serverIP, NULL, port);
-
-	if (hostResolved == -1)
-	{
-		string msg = "Failed to open the server socket: ";
-		msg += SDLNet_GetError();
-
-		SocketException e(msg);
-		throw e;
-	}
-	else // If we resolved the host successfully, output the details
-	{
-		if (debug)
-		{
-			// Get our IP address in proper dot-quad format by breaking up the 32-bit unsigned
-			// host address and splitting it into an array of four 8-bit unsigned numbers...
-			Uint8 * dotQuad = (Uint8*)&serverIP.host;
-
-			dotQuadString = toString((unsigned short)dotQuad[0]);
-			dotQuadString += ".";
-			dotQuadString += toString((unsigned short)dotQuad[1]);
-			dotQuadString += ".";
-			dotQuadString += toString((unsigned short)dotQuad[2]);
-			dotQuadString += ".";
-			dotQuadString += toString((unsigned short)dotQuad[3]);
-
-			//... and then outputting them cast to integers. Then read the last 16 bits of the serverIP object to get the port number
-			cout << "Successfully resolved server host to IP: " << dotQuadString;
-			cout << ", will use port " << SDLNet_Read16(&serverIP.port) << endl;
-		}
-	}
-
-	// Try to open the server socket
-	serverSocket = SDLNet_TCP_Open(&serverIP);
-
-	if (!serverSocket)
-	{
-		string msg = "Failed to open the server socket: ";
-		msg += SDLNet_GetError();
-
-		SocketException e(msg);
-		throw e;
-	}
-	else
-	{
-		if (debug) { cout << "Sucessfully created server socket." << endl; }
-	}
-
-	// Add our server socket (i.e. the listening socket) to the socket set
-	SDLNet_TCP_AddSocket(socketSet, serverSocket);
+	// Read every account once, logins and signups never touch the file again (other than signups appending to it)
+	accounts.load("data/userInfo.txt");
 
 	if (debug) {
-		cout << "Awaiting clients..." << endl;
+		cout << "Listening on port " << port << ", awaiting clients..." << endl;
 	}
 
 } // End of constructor
@@ -125,37 +87,27 @@ ServerSocket::ServerSocket(unsigned int thePort, unsigned int theBufferSize, uns
 ServerSocket::~ServerSocket()
 {
 	// Close all the open client sockets
-	for (unsigned int loop = 0; loop < maxClients; loop++)
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
 	{
-		if (pSocketIsFree[loop] == false)
+		if (sessions[loop].free == false)
 		{
-			SDLNet_TCP_Close(pClientSocket[loop]);
-			pSocketIsFree[loop] = true;
+			pReactor->removeClient(sessions[loop].socket);
+			pReactor->closeClient(sessions[loop].socket);
+			sessions[loop].free = true;
 		}
 	}
 
 	// Close our server socket
-	SDLNet_TCP_Close(serverSocket);
-
-	// Free our socket set
-	SDLNet_FreeSocketSet(socketSet);
-
-	// Release any properties on the heap
-	delete pClientSocket;
-	delete pSocketIsFree;
-	delete pBuffer;
+	delete pReactor;
 }
 
 
-void ServerSocket::checkForConnections()
+void ServerSocket::checkForConnections(int timeoutMs)
 {
-	// Check for activity on the entire socket set. The second parameter is the number of milliseconds to wait for.
-	// For the wait-time, 0 means do not wait (high CPU!), -1 means wait for up to 49 days (no, really), and any other
-	// number is a number of milliseconds, i.e. 5000 means wait for 5 seconds, 50 will poll (1000 / 50 = 20) times per second.
-	// I've used 1ms below, so we're polling 1,000 times per second, which is overkill for a small chat server, but might
-	// be a good choice for a FPS server where every ms counts! Also, 1,000 polls per second produces negligable CPU load,
-	// if you put it on 0 then it WILL eat all the available CPU time on one of your cores...
-	int numActiveSockets = SDLNet_CheckSockets(socketSet, 1);
+	// Wait for activity on any of our sockets. The parameter is the number of milliseconds to wait for, where 0
+	// means do not wait (high CPU!) and -1 means wait until something happens. Unlike the old SDLNet_CheckSockets
+	// polling, we're woken up as soon as a socket has data so there's no need to spin with a tiny timeout.
+	int numActiveSockets = pReactor->wait(timeoutMs);
 
 	if (numActiveSockets != 0)
 	{
@@ -164,46 +116,61 @@ void ServerSocket::checkForConnections()
 		}
 	}
 
-	// Check if our server socket has received any data
-	// Note: SocketReady can only be called on a socket which is part of a set and that has CheckSockets called on it (the set, that is)
-	// SDLNet_SocketRead returns non-zero for activity, and zero is returned for no activity. Which is a bit bass-ackwards IMHO, but there you go.
-	int serverSocketActivity = SDLNet_SocketReady(serverSocket);
+	// Remember which clients have data waiting - checkForActivity() will work through them
+	const std::vector<int> &readySlots = pReactor->getReadySlots();
+	readyClients.insert(readyClients.end(), readySlots.begin(), readySlots.end());
 
-	// If there is activity on our server socket (i.e. a client has trasmitted data to us) then...
-	if (serverSocketActivity != 0)
+	// Accept every connection that's waiting (edge-triggered, so we must drain the backlog now)
+	while (pReactor->hasPendingConnections())
 	{
+		ClientHandle newClient = pReactor->acceptClient();
+
+		if (newClient == NO_CLIENT)
+		{
+			break;
+		}
+
 		// If we have room for more clients...
-		if (clientCount < maxClients)
+		if (!freeSlots.empty() || sessions.size() < maxClients)
 		{
-			// Find the first free socket in our array of client sockets
-			int freeSpot = -99;
-			for (unsigned int loop = 0; loop < maxClients; loop++)
-			{
-				if (pSocketIsFree[loop] == true)
-				{
-					if (debug) {
-						cout << "Found a free spot at element: " << loop << endl;
-					}
-
-					pSocketIsFree[loop] = false; // Set the socket to be taken
-					freeSpot = loop;             // Keep the location to add the new connection at that index in the array
-					break;                       // Break out of the loop straight away
-				}
+			// Take a free slot off the free list, or if every slot's in use add another one to the session table
+			unsigned int freeSpot;
+			if (!freeSlots.empty()) {
+				freeSpot = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			else {
+				freeSpot = (unsigned int)sessions.size();
+				sessions.emplace_back();
 			}
+			sessions[freeSpot].free = false; // Set the socket to be taken
 
-			// ...accept the client connection and then...
-			pClientSocket[freeSpot] = SDLNet_TCP_Accept(serverSocket);
+			if (debug) {
+				cout << "Found a free spot at element: " << freeSpot << endl;
+			}
+
+			// ...keep the client connection and give it an empty receive buffer, then...
+			sessions[freeSpot].socket = newClient;
+			sessions[freeSpot].framer.reset(bufferSize, MAX_MESSAGE_SIZE);
+			sessions[freeSpot].protocolVersion = 0;
+			sessions[freeSpot].outbound.clear();
+			sessions[freeSpot].passwordJob = 0;
+			sessions[freeSpot].bytesIn = 0;
+			sessions[freeSpot].bytesOut = 0;
+			sessions[freeSpot].messagesIn = 0;
+			sessions[freeSpot].snapshots.reset();
 
-			// ...add the new client socket to the socket set (i.e. the list of sockets we check for activity)
-			SDLNet_TCP_AddSocket(socketSet, pClientSocket[freeSpot]);
+			// ...start watching the new client socket for activity
+			pReactor->addClient(newClient, freeSpot);
+
+			// We don't know where they are yet, so they hear about everything until they tell us
+			interest.addClient(freeSpot);
 
 			// Increase our client count
 			clientCount++;
 
 			// Send a message to the client saying "OK" to indicate the incoming connection has been accepted
-			strcpy(pBuffer, SERVER_NOT_FULL.c_str());
-			int msgLength = strlen(pBuffer) + 1;
-			SDLNet_TCP_Send(pClientSocket[freeSpot], (void *)pBuffer, msgLength);
+			sendToClient(freeSpot, SERVER_NOT_FULL.c_str(), SERVER_NOT_FULL.length() + 1);
 
 			if (debug) { cout << "Client connected. There are now " << clientCount << " client(s) connected." << endl; }
 		}
@@ -211,920 +178,1374 @@ void ServerSocket::checkForConnections()
 		{
 			if (debug) { cout << "Max client count reached - rejecting client connection" << endl; }
 
-			// Accept the client connection to clear it from the incoming connections list
-			TCPsocket tempSock = SDLNet_TCP_Accept(serverSocket);
-
 			// Send a message to the client saying "FULL" to tell the client to go away
-			strcpy(pBuffer, SERVER_FULL.c_str());
-			int msgLength = strlen(pBuffer) + 1;
-			SDLNet_TCP_Send(tempSock, (void *)pBuffer, msgLength);
+			pReactor->sendAll(newClient, SERVER_FULL.c_str(), SERVER_FULL.length() + 1);
 
 			// Shutdown, disconnect, and close the socket to the client
-			SDLNet_TCP_Close(tempSock);
+			pReactor->closeClient(newClient);
 		}
 
-	} // End of if server socket is has activity check
+	} // End of accept loop
+
+	// Anything that's come in on the UDP socket
+	readDatagrams();
 
 } // End of checkActivity function
 
-// Function to do something appropriate with the detected socket activity (i.e. we received a message from a client)
-// You should put whatever you want to happen when a message is sent from a client inside this function!
-// In this example case, I'm going to send the message to all other connected clients except the one who originated the message!
-void ServerSocket::dealWithActivity(unsigned int clientNumber)
+// Function to read every datagram waiting on the UDP socket
+void ServerSocket::readDatagrams()
 {
-	// Get the contents of the buffer as a string
-	string bufferContents = pBuffer;
+	if (!udpOpen) {
+		return;
+	}
 
-	// Output the message the server received to the screen
-	if (debug) {
-		cout << "Received: >>>> " << bufferContents << " from client number: " << clientNumber << endl;
+	UdpAddress from;
+	int length;
+
+	while (pReactor->hasPendingDatagrams() && (length = pReactor->receiveDatagram(&datagramBuffer[0], (int)datagramBuffer.size(), from)) >= 0)
+	{
+		dealWithDatagram(&datagramBuffer[0], length, from);
+	}
+}
+
+// Function to deal with one datagram. Anything we can't make sense of, or that isn't from a client with a channel,
+// is dropped without a word - anyone can send us datagrams, so there's no one to tell
+void ServerSocket::dealWithDatagram(const char *data, int length, const UdpAddress &from)
+{
+	if (length < 1) {
+		return;
 	}
 
-	//if message was not meant for server..
+	// A client saying which address their datagrams will come from
+	if ((uint8_t)data[0] == WIRE_MSG_UDP_HELLO)
+	{
+		uint64_t token;
+		if (!decodeUdpHello(data, length, token)) {
+			return;
+		}
 
-	if (bufferContents[0] != '!') {
+		auto found = udpTokens.find(token);
+		if (found == udpTokens.end()) {
+			return;
+		}
 
-		// Send message to all other connected clients
-		for (unsigned int loop = 0; loop < maxClients; loop++)
-		{
-			// Send a message to the client saying "OK" to indicate the incoming connection has been accepted
-			//strcpy( buffer, SERVER_NOT_FULL.c_str() );
-			unsigned int msgLength = strlen(pBuffer) + 1;
+		unsigned int clientNumber = found->second;
+		Session &session = sessions[clientNumber];
 
-			// If the message length is more than 1 (i.e. client pressed enter without entering any other text), then
-			// send the message to all connected clients except the client who originated the message in the first place
-			if ((msgLength > 1) && (loop != clientNumber) && (pSocketIsFree[loop] == false))
-			{
-				if (debug) {
-					cout << "Retransmitting: " << bufferContents << " (" << msgLength << " bytes) to client " << loop << endl;
-				}
-				
-				SDLNet_TCP_Send(pClientSocket[loop], (void *)pBuffer, msgLength);
+		// Hellos keep coming until the client hears back, so only the first from an address needs anything doing
+		if (session.udpBound && session.udpAddress == from) {
+			return;
+		}
+
+		// They've moved (i.e. a NAT's given them a new port), so forget where they were
+		if (session.udpBound) {
+			auto old = udpClients.find(udpAddressKey(session.udpAddress));
+			if (old != udpClients.end() && old->second == clientNumber) {
+				udpClients.erase(old);
 			}
 		}
 
-	}
-	//if command is meant for server...
-	else {
-		//delete first character of string '!'
-		bufferContents.erase(bufferContents.begin());
+		// And anyone else who was at this address isn't any more
+		auto previous = udpClients.find(udpAddressKey(from));
+		if (previous != udpClients.end() && previous->second != clientNumber) {
+			sessions[previous->second].udpBound = false;
+			sessions[previous->second].udpQueue.clear();
+		}
 
-		// if user is trying to add themselves to list of players..
-		if (bufferContents[0] == 'u' && bufferContents[1] == 's' && bufferContents[2] == 'e') {
+		session.udpBound = true;
+		session.udpAddress = from;
+		udpClients[udpAddressKey(from)] = clientNumber;
 
-			//deleting 'use'
-			bool foundPlayers = false;
+		if (debug) { cout << "Client " << clientNumber << " has a UDP channel." << endl; }
 
-			while (foundPlayers == false) {
+		sendToClient(clientNumber, "udpok~", 7);
+		return;
+	}
 
-				if (bufferContents[0] != ':') {
-					bufferContents.erase(bufferContents.begin() + 0);
-				}
-				else {
-					foundPlayers = true;
-					bufferContents.erase(bufferContents.begin());
-				}
+	// Otherwise it should be updates from a client with a channel
+	auto found = udpClients.find(udpAddressKey(from));
+	if (found == udpClients.end()) {
+		return;
+	}
 
+	unsigned int clientNumber = found->second;
+	uint32_t sequence;
 
-			}
+	if (!decodeUdpState(data, length, sequence, datagramMessages)) {
+		return;
+	}
 
-			//adding username to list of players
-			playerList[clientNumber] = bufferContents;
-			cout << bufferContents << " joined the game!" << endl;
+	// Older than one we've had already? then what's in it is out of date
+	if (!isNewerSequence(sequence, sessions[clientNumber].udpReceiveSequence)) {
+		return;
+	}
 
+	sessions[clientNumber].udpReceiveSequence = sequence;
+	sessions[clientNumber].bytesIn += length;
 
+	// Only position updates and snapshot acks can come this way, everything else has to come over TCP
+	for (unsigned int i = 0; i < datagramMessages.size() && sessions[clientNumber].free == false; i++)
+	{
+		const WireSlice &slice = datagramMessages[i];
+		uint32_t acknowledged;
+
+		if (slice.length > 0 && (uint8_t)slice.data[0] == WIRE_MSG_POSITION)
+		{
+			sessions[clientNumber].messagesIn++;
+			dealWithMessage(clientNumber, std::string_view(slice.data, slice.length));
 		}
+		else if (sessions[clientNumber].protocolVersion >= 3 && decodeSnapshotAck(slice.data, slice.length, acknowledged))
+		{
+			sessions[clientNumber].messagesIn++;
+			sessions[clientNumber].snapshots.acknowledge(acknowledged);
+		}
+	}
+}
 
-		//if client is trying to shoot
-		if (bufferContents[0] == 's' && bufferContents[1] == 'h' && bufferContents[2] == 'o' &&  bufferContents[3] == 'o' && bufferContents[4] == 't') {
-			
-			//delete beginning
-			bufferContents.erase(bufferContents.begin(),bufferContents.begin() + 6);
-			//string array for passed in stuff
-			vector<string> shootInfo;
+// Function to close a client's UDP channel (if they have one)
+void ServerSocket::closeUdpChannel(unsigned int clientNumber)
+{
+	Session &session = sessions[clientNumber];
 
-			//variable to count down iteration of string
-			int counting = 0;
+	if (session.udpToken != 0) {
+		udpTokens.erase(session.udpToken);
+	}
+
+	if (session.udpBound) {
+		auto found = udpClients.find(udpAddressKey(session.udpAddress));
+		if (found != udpClients.end() && found->second == clientNumber) {
+			udpClients.erase(found);
+		}
+	}
 
-			//getting out inputs we need
-			while (bufferContents.length() > 2) {
-				counting = bufferContents.length() - 1;
-				bool tempBool = true;
+	session.udpToken = 0;
+	session.udpBound = false;
+	session.udpAddress = UdpAddress();
+	session.udpSendSequence = 0;
+	session.udpReceiveSequence = 0;
+	session.udpQueue.clear();
+}
 
-				if (bufferContents.length() > 2) {
+// Function to do something appropriate with the detected socket activity (i.e. we received data from a client).
+// A single read can contain any number of messages (or part of one), so hand every complete frame in the client's
+// receive buffer on to dealWithMessage and leave any partial frame there until the rest of it arrives.
+void ServerSocket::dealWithActivity(unsigned int clientNumber)
+{
+	const char *frame;
+	int frameLength;
 
-					bufferContents.erase(bufferContents.begin() + counting);
-					counting--;
+	// The client can be disconnected part way through (i.e. if a message makes us drop them), so check each time
+	while (sessions[clientNumber].free == false && sessions[clientNumber].framer.nextFrame(frame, frameLength))
+	{
+		// Skip empty messages (i.e. client pressed enter without entering any other text)
+		if (frameLength > 0)
+		{
+			sessions[clientNumber].messagesIn++;
+			dealWithMessage(clientNumber, std::string_view(frame, frameLength));
+		}
+	}
 
-					while (tempBool) {
+	// If the client sent something we can't make sense of (i.e. a message bigger than we allow) then drop them
+	if (sessions[clientNumber].free == false && sessions[clientNumber].framer.hasError())
+	{
+		if (debug) { cout << "Client " << clientNumber << " sent an oversized message, disconnecting." << endl; }
+		disconnectClient(clientNumber);
+	}
 
-						if (bufferContents[counting] != '~') {
-							counting--;
-						}
-						else {
-							tempBool = false;
-						}
+} // End of dealWithActivity function
 
-					}
+// Function to do something with one message from a client
+// You should put whatever you want to happen when a message is sent from a client inside this function!
+// In this example case, I'm going to send the message to all other connected clients except the one who originated the message!
+// Note: message points straight into the client's receive buffer, so it's only valid until we read from them again
+void ServerSocket::dealWithMessage(unsigned int clientNumber, std::string_view message)
+{
+	// Output the message the server received to the screen
+	if (debug) {
+		cout << "Received: >>>> " << message << " from client number: " << clientNumber << endl;
+	}
 
-					shootInfo.push_back(bufferContents.substr(counting + 1, ((bufferContents.length() - 1) - counting + 1)));
-					bufferContents.erase(counting, ((bufferContents.length() - 1) - counting));
-				}
+	//if message was not meant for server..
 
-			}
+	if (message[0] != '!') {
 
-			string typeOfShotServer = "";
-			//getting out shot type
-			for (int a = 0; a < shootInfo.size(); a++) {
-				if (shootInfo[a][0] == 's' && shootInfo[a][1] == 'h' && shootInfo[a][2] == 'o' && shootInfo[a][3] == 't') {
+		// Binary messages (see WireProtocol.h) only go to clients that have asked for the binary protocol
+		bool binaryMessage = isBinaryMessage(message.data(), message.length());
 
-					typeOfShotServer = shootInfo[a];
+		// Build the message we'll pass on in a buffer we keep around, so relaying doesn't allocate
+		relayBuffer.clear();
 
-				}
+		// A binary position update gets stamped with the sender's player id, so clients can't pretend to be someone else
+		if (binaryMessage) {
+			WirePosition position;
+
+			//no player, no ship (same as "pos:")
+			if (!players.hasName(clientNumber) || !decodePosition(message.data(), message.length(), position)) {
+				return;
 			}
 
-			///// looping through info for shot
-
-			//////// if shot is blaster //////////////
-			if (typeOfShotServer == "shot:blaster") {
-				for (int i = 0; i < shootInfo.size(); i++) {
-					//if info contains username
-					if (shootInfo[i][0] == 'u' && shootInfo[i][1] == 's' && shootInfo[i][2] == 'e' && shootInfo[i][3] == 'r') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 5);
-						shotName.push_back(shootInfo[i]);
-						shotName.push_back(shootInfo[i]);
-					}
-					if (shootInfo[i][0] == 's' && shootInfo[i][1] == 'h' && shootInfo[i][2] == 'o' && shootInfo[i][3] == 't') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 5);
-						shotType.push_back(shootInfo[i]);
-						shotType.push_back(shootInfo[i]);
-					}
-					if (shootInfo[i][0] == 'x' && shootInfo[i][1] == 'c' && shootInfo[i][2] == 'o' && shootInfo[i][3] == 'r') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 6);
-						shotX.push_back(stoi(shootInfo[i]));
-					}
-					if (shootInfo[i][0] == 'y' && shootInfo[i][1] == 'c' && shootInfo[i][2] == 'o' && shootInfo[i][3] == 'r') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 6);
-						shotY.push_back(stoi(shootInfo[i]));
-					}
-					if (shootInfo[i][0] == 'r' && shootInfo[i][1] == 'o' && shootInfo[i][2] == 't' && shootInfo[i][3] == 'a') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 6);
-						shotRotation.push_back(stoi(shootInfo[i]));
-						shotRotation.push_back(stoi(shootInfo[i]));
-					}
-					if (shootInfo[i][0] == 'x' && shootInfo[i][1] == 'v' && shootInfo[i][2] == 's' && shootInfo[i][3] == 'h' && shootInfo[i][4] == 'o' && shootInfo[i][5] == 't') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 7);
-						shotStartVelocityX.push_back(stoi(shootInfo[i]));
-						shotStartVelocityX.push_back(stoi(shootInfo[i]));
-					}
-					if (shootInfo[i][0] == 'y' && shootInfo[i][1] == 'v' && shootInfo[i][2] == 's' && shootInfo[i][3] == 'h' && shootInfo[i][4] == 'o' && shootInfo[i][5] == 't') {
-						shootInfo[i].erase(shootInfo[i].begin(), shootInfo[i].begin() + 7);
-						shotStartVelocityY.push_back(stoi(shootInfo[i]));
-						shotStartVelocityY.push_back(stoi(shootInfo[i]));
-					}
-
-					//setting shot time to zero
-					shotTime.push_back(0);
-					shotTime.push_back(0);
-					////giving unique name to shot
-
-					for (int z = 0; z <= 1; z++) {
-						bool finished = false;
-
-						while (finished == false) {
-							finished = true;
-							string vaf = to_string((rand() % 99999)) + "abc";
-
-							for (int b = 0; b < uniqueName.size(); b++) {
-
-								if (vaf == uniqueName[b]) {
-									finished = false;
-								}
-
-							}
-
-							if (finished) {
-								uniqueName.push_back(vaf);
-							}
-
-
-						}
-					}
+			position.playerId = internPlayer(players.getName(clientNumber));
+			encodePosition(position, relayBuffer);
 
+			//keep track of where their ship is, for shots to hit and for working out who's close enough to care
+			world.setShip(clientNumber, position.playerId, position.x, position.y);
+			interest.setClientPosition(clientNumber, position.x, position.y);
+			prefetchChunks(clientNumber, position.x, position.y);
+		}
+		else {
+			// Include the terminator on text messages, which is how text clients tell where one message ends and the next begins
+			relayBuffer.append(message.data(), message.length());
+			relayBuffer.push_back('\0');
+		}
 
+		// Work out who to pass it on to: once we know where the sender is, only clients in or around their chunk
+		// (and any who haven't told us where they are), otherwise everyone
+		if (interest.isPlaced(clientNumber)) {
+			interest.findInterested(interest.getChunkX(clientNumber), interest.getChunkY(clientNumber), recipients);
+		}
+		else {
+			recipients.clear();
+			for (unsigned int loop = 0; loop < sessions.size(); loop++) {
+				if (sessions[loop].free == false) {
+					recipients.push_back(loop);
 				}
-
 			}
-				for (int i = 0; i < shootInfo.size(); i++) {
-					shootInfo[i] = "";
-				}
-				//update shooting
-				updateShooting();
 		}
 
-		// if client is requesting a chunk
-		if (bufferContents[0] == 'l' && bufferContents[1] == 'o' && bufferContents[2] == 'a' && bufferContents[3] == 'd' && bufferContents[4] == 'c' && bufferContents[5] == 'h') {
+		// One copy of the message, shared by everyone it goes to
+		SharedPayload payload = makePayload(relayBuffer.c_str(), relayBuffer.length());
 
-			//deleting 'loadchunk:'
-			bool foundPlayers = false;
+		// Send message to the other clients
+		for (unsigned int i = 0; i < recipients.size(); i++)
+		{
+			unsigned int loop = recipients[i];
 
-			while (foundPlayers == false) {
+			// Send the message to all of them except the client who originated the message in the first place
+			if ((loop != clientNumber) && (sessions[loop].free == false) && (!binaryMessage || sessions[loop].protocolVersion > 0))
+			{
+				if (debug) {
+					cout << "Retransmitting: " << message << " (" << relayBuffer.length() << " bytes) to client " << loop << endl;
+				}
 
-				if (bufferContents[0] != ':') {
-					bufferContents.erase(bufferContents.begin() + 0);
+				//positions are sent every frame, so binary ones can go by UDP (a lost one is soon replaced)
+				if (binaryMessage) {
+					sendStateToClient(loop, payload);
 				}
 				else {
-					foundPlayers = true;
-					bufferContents.erase(bufferContents.begin());
+					sendToClient(loop, payload);
 				}
-
 			}
+		}
 
+		// If the client told us to shut down the server, then set the flag to get us out of the main loop and shut down
+		if (message == SHUTDOWN_SIGNAL)
+		{
+			shutdownServer = true;
 
+			if (debug) { cout << "Disconnecting all clients and shutting down the server..." << endl; }
+		}
 
-			//getting out x and y of chunks
-			string getChunkX = bufferContents;
-			string getChunkY = bufferContents;
+	}
+	//if command is meant for server, hand it to whoever deals with that command (skipping the '!')
+	else {
+		commands.dispatch(*this, clientNumber, message.substr(1));
+	}
 
+} // End of dealWithMessage function
 
+// if client wants to switch to length-prefixed framing ("frame~")
+void ServerSocket::handleFrame(unsigned int clientNumber, std::string_view) {
 
-			//getting out chunkx
+	// confirm using the framing the client has been using so far, then switch over
+	sendToClient(clientNumber, "frameok", 8);
+	sessions[clientNumber].framer.setMode(FRAMING_LENGTH_PREFIXED);
 
-			bool foundUser2 = false;
-			bool holdv = false;
-			int usernameVariable = 0;
+}
 
-			while (foundUser2 == false) {
+// if client wants to use the binary protocol ("proto:<version>~")
+void ServerSocket::handleProto(unsigned int clientNumber, std::string_view args) {
 
-				if (holdv) {
+	int requestedVersion = 0;
+	parseInt(args.substr(0, args.find('~')), requestedVersion);
 
-					if (getChunkX[usernameVariable] == '~') {
-						foundUser2 = true;
-					}
+	//use the newest version we both understand (0 means stay on text)
+	int version = requestedVersion < WIRE_PROTOCOL_VERSION ? requestedVersion : WIRE_PROTOCOL_VERSION;
+	if (version < 0) {
+		version = 0;
+	}
 
-					getChunkX.erase(getChunkX.begin() + usernameVariable);
+	string reply = "proto:" + to_string(version);
+	sendToClient(clientNumber, reply.c_str(), reply.length() + 1);
 
-				}
-				else {
+	if (version > 0) {
 
-					if (getChunkX[usernameVariable] == ',') {
-						getChunkX.erase(getChunkX.begin() + usernameVariable);
-						usernameVariable--;
-						holdv = true;
-					}
-					usernameVariable++;
-				}
-			}
+		// binary messages need length-prefixed framing
+		sessions[clientNumber].framer.setMode(FRAMING_LENGTH_PREFIXED);
+		sessions[clientNumber].protocolVersion = version;
 
-			///// getting out chunk y /////
-			bool foundPassword = false;
-			bool holdvPass = false;
-			int passwordVariable = 0;
+		// tell the client the id of everyone who's on
+		if (playerIds.size() > 0) {
+			vector<WirePlayerName> names;
+			names.reserve(playerIds.size());
+			for (unordered_map<string, unsigned int>::const_iterator player = playerIds.begin(); player != playerIds.end(); player++) {
+				WirePlayerName name;
+				name.id = player->second;
+				name.name = player->first;
+				names.push_back(name);
+			}
 
-			while (foundPassword == false) {
-				if (holdvPass == false) {
+			string namesMessage;
+			encodePlayerNames(names, namesMessage);
+			sendToClient(clientNumber, namesMessage.c_str(), namesMessage.length());
+		}
+	}
 
-					if (getChunkY[0] != ',') {
+}
 
-						getChunkY.erase(getChunkY.begin() + 0);
+// if user is trying to add themselves to list of players ("use:<username>~")
+void ServerSocket::handleUse(unsigned int clientNumber, std::string_view args) {
 
-					}
-					else {
-						holdvPass = true;
-						getChunkY.erase(getChunkY.begin());
+	//the name without its '~', so it's the same as the one they logged in with (and safe to put in a '~' separated message)
+	std::string_view username = args.substr(0, args.find('~'));
 
-					}
-				}
-				else {
+	//adding username to list of players (whoever they were playing as before gives up their id)
+	//("use:~" is no name at all, so it just takes away the one they had)
+	string previous = players.getName(clientNumber);
+	if (username.empty()) {
+		players.clear(clientNumber);
+	}
+	else {
+		players.setName(clientNumber, string(username));
+	}
+	releasePlayer(previous);
 
-					if (getChunkY[passwordVariable] == '~') {
-						foundPassword = true;
-						getChunkY.erase(getChunkY.begin() + passwordVariable);
-					}
-					else {
-						passwordVariable++;
-					}
+	if (!players.hasName(clientNumber)) {
+		return;
+	}
+	internPlayer(players.getName(clientNumber));
 
-				}
+	SessionEvent event;
+	event.kind = SESSION_JOIN;
+	event.clientNumber = clientNumber;
+	event.username = players.getName(clientNumber);
+	sessionEvents.push(event);
 
-			}
+}
 
-			//checking if chunk already exists
-			std::ifstream f("data/chunks/" + bufferContents + ".txt");
-			if (!f.good()) {
-
-				//if chunk doesn't exist	
-
-
-				/////////////////////   setting planet values   //////////////////
-
-
-				// variables
-					int numPlanets = 10;
-
-				    vector<bool> planetInit;
-					vector<int> planetX;
-					vector<int> planetY;
-					vector<int> planetR;
-					vector<int> planetG;
-					vector<int> planetB;
-					vector<int> planetDiameter;
-					vector<int> planetImage;
+// if client is trying to shoot
+void ServerSocket::handleShoot(unsigned int clientNumber, std::string_view args) {
 
-					//resetting variables
-					planetInit.resize(numPlanets);
-					planetX.resize(numPlanets);
-					planetY.resize(numPlanets);
-					planetR.resize(numPlanets);
-					planetG.resize(numPlanets);
-					planetB.resize(numPlanets);
-					planetDiameter.resize(numPlanets);
-					planetImage.resize(numPlanets);
+	// shots belong to whoever's playing on the connection they came from, so nobody can fire as someone else
+	if (!players.hasName(clientNumber)) {
+		return;
+	}
 
-					planetInit.shrink_to_fit();
-					planetX.shrink_to_fit();
-					planetY.shrink_to_fit();
-					planetR.shrink_to_fit();
-					planetG.shrink_to_fit();
-					planetB.shrink_to_fit();
-					planetDiameter.shrink_to_fit();
-					planetImage.shrink_to_fit();
+	ShootCommand shot;
+	if (!parseShootCommand(args, shot)) {
+		return;
+	}
 
-					//resetting planets
-					for (int i = 0; i < numPlanets; i++) {
-						planetInit.at(i) = false;
+	// only shot types we know about (i.e. "blaster") are tracked
+	int typeId = shots.findType(string(shot.type));
+	if (typeId == -1) {
+		return;
+	}
 
-					}
+	unsigned int ownerId = internPlayer(players.getName(clientNumber));
 
-					//(rand() % 3000) + 1;
-					int randx = 0;
-					int randy = 0;
+	// one shot per barrel, all heading the same way (we simulate in units per second rather than per client frame)
+	for (int i = 0; i < shot.numBarrels; i++) {
+		shots.spawn((uint8_t)typeId, ownerId, shot.x[i], shot.y[i], shot.rotation,
+			shot.velocityX * CLIENT_FRAMES_PER_SECOND, shot.velocityY * CLIENT_FRAMES_PER_SECOND);
+	}
 
-					int planetCounter = 0;
+	//they go out to everyone with the rest of the shots at the end of the tick
 
-					int xSide;
-					int ySide;
-					int sideLength;
-					//looping through all planets..
-					for (int i = 0; i < numPlanets; i++) {
+}
 
-						//setting planet Image
-						planetImage[i] = (rand() % 30);
+// if client is requesting a chunk ("loadchunk:<x>,<y>~")
+void ServerSocket::handleLoadChunk(unsigned int clientNumber, std::string_view args) {
 
-						while (planetInit[i] == false) {
+	int chunkX;
+	int chunkY;
+	if (!parseChunkCommand(args, chunkX, chunkY) || !isValidChunk(chunkX, chunkY)) {
+		return;
+	}
 
-							randx = ((20000*stoi(getChunkX)) ) + (rand() % 19000) + 500;
-							randy = (((20000)*stoi(getChunkY))) + (rand() %19000) + 500;
-							planetDiameter[i] = 300 + (rand() % 1400);
+	//chunks near where everyone is get asked for over and over, so keep the replies around
+	SharedPayload reply = chunkCache.find(chunkX, chunkY);
 
-							//used to make sure new planet works with EVERY existing planet
-							planetCounter = 0;
+	if (reply) {
+		sendToClient(clientNumber, reply);
+		return;
+	}
 
-							//checking for first planet
-							if (i == 0) {
-								//the planet x and y is the middle of the planet
-								planetX[i] = randx;
-								planetY[i] = randy;
-								planetR[i] = (rand() % 255);
-								planetG[i] = (rand() % 255);
-								planetB[i] = (rand() % 255);
+	//otherwise it gets loaded (or made) on a worker thread, and sent from collectLoadedChunks() when it's ready
+	chunkLoader.request(chunkX, chunkY, clientNumber);
 
-								//seeing if planet has been initialized
-								planetInit[i] = true;
-							}
-							else {
-								//if not the first planet...
-								for (int z = 0; z < i; z++) {
+}
 
-									//getting x and y sides to calculate distance between planets
-									xSide = abs((randx + (planetDiameter[i] / 2)) - (planetX[z] + (planetDiameter[z] / 2)));
-									ySide = abs(randy - (planetDiameter[i] / 2) - (planetY[z] - (planetDiameter[z] / 2)));
+// get the chunks a client is about to need into the cache, and (if we're pushing) onto its queue
+void ServerSocket::prefetchChunks(unsigned int clientNumber, double x, double y) {
 
-									//distance between planets
-									sideLength = sqrt((xSide *xSide) + (ySide*ySide));
+	if (!prefetchEnabled || !prefetcher.update(clientNumber, x, y, prefetchWarm, prefetchEntered)) {
+		return;
+	}
 
-									//making sure random values dont intercept inited planets X
-									if (sideLength > ((planetDiameter[i] * 2) + planetDiameter[z])) {
-										planetCounter = planetCounter + 1;
-									}
-									else {
-									}
-									//making sure random values dont intercept inited planets Y
-									if (planetCounter == i) {
+	if (pushPrefetched) {
+		for (unsigned int i = 0; i < prefetchEntered.size(); i++) {
+			int chunkX = chunkKeyX(prefetchEntered[i]);
+			int chunkY = chunkKeyY(prefetchEntered[i]);
 
-										planetX[i] = randx;
-										planetY[i] = randy;
-										planetR[i] = (rand() % 255);
-										planetG[i] = (rand() % 255);
-										planetB[i] = (rand() % 255);
+			SharedPayload reply = chunkCache.peek(chunkX, chunkY);
+			if (reply) {
+				sendToClient(clientNumber, reply);
+			}
+			else {
+				chunkLoader.request(chunkX, chunkY, clientNumber);
+			}
+		}
+	}
 
-										//seeing if planet has been initialized
-										planetInit[i] = true;
-									}
+	//peek() counts as using the chunk, so it won't get evicted right before it's needed
+	for (unsigned int i = 0; i < prefetchWarm.size(); i++) {
+		int chunkX = chunkKeyX(prefetchWarm[i]);
+		int chunkY = chunkKeyY(prefetchWarm[i]);
 
+		if (!chunkCache.peek(chunkX, chunkY)) {
+			chunkLoader.prefetch(chunkX, chunkY);
+		}
+	}
 
-								}
+}
 
-							}
+void ServerSocket::forgetUnusedPlanets() {
 
-						}
+	// Every cached chunk has to keep its planets (asking for it again is a cache hit, so they'd never come back)
+	world.getChunks(planetChunks);
 
+	for (unsigned int i = 0; i < planetChunks.size(); i++) {
+		int chunkX = chunkKeyX(planetChunks[i]);
+		int chunkY = chunkKeyY(planetChunks[i]);
 
-					}
+		if (!chunkCache.contains(chunkX, chunkY) && !interest.hasClientsNear(chunkX, chunkY)) {
+			world.removeChunk(chunkX, chunkY);
+		}
+	}
 
-					//writing variables to file
-					std::ofstream out("data/chunks/" + bufferContents + ".txt");
+}
 
-					for (int i = 0; i < numPlanets; i++) {
+void ServerSocket::startChunkWorkers(unsigned int numWorkers) {
+	chunkLoader.start(numWorkers, [this] { pReactor->wake(); });
+}
 
+void ServerSocket::collectLoadedChunks() {
 
-						out << std::to_string(planetX[i]) + " " + std::to_string(planetY[i]) + " " + std::to_string(planetDiameter[i]) + " " + std::to_string(planetR[i]) + " " + std::to_string(planetG[i]) + " " + std::to_string(planetB[i]) + " " + std::to_string(planetImage[i]) << endl;
+	loadedChunks.clear();
+	chunkLoader.takeFinished(loadedChunks);
 
-					}
+	for (unsigned int c = 0; c < loadedChunks.size(); c++) {
+		LoadedChunk &chunk = loadedChunks[c];
 
-					out.close();
+		chunkCache.insert(chunk.chunkX, chunk.chunkY, chunk.reply);
 
+		//keep the chunk's planets around for shots to hit
+		if (!world.hasChunk(chunk.chunkX, chunk.chunkY)) {
+			for (unsigned int i = 0; i < chunk.planets.size(); i++) {
+				world.addPlanet(chunk.chunkX, chunk.chunkY, i, chunk.planets[i].x, chunk.planets[i].y, chunk.planets[i].diameter);
 			}
+		}
 
-			//////////// returning chunk data to player ////////////
-			string chunkData = "";
-			string tempString = "retchunk" + getChunkX + "~" + getChunkY;
-
-			std::ifstream planetInfo;
-
-			planetInfo.open("data/chunks/" + bufferContents + ".txt", std::ifstream::in);
-
-			while (planetInfo.good()) {
-
-				chunkData += tempString + "~";
-				planetInfo >> tempString;
+		//sending chunk info to everyone that asked for it while it was loading
+		chunkLoader.takeWaiting(chunk.chunkX, chunk.chunkY, chunkWaiters);
+		for (unsigned int i = 0; i < chunkWaiters.size(); i++) {
+			sendToClient(chunkWaiters[i], chunk.reply);
+		}
+	}
 
-			}
+}
 
-			planetInfo.close();
-			//sending chunk info to player
-			SDLNet_TCP_Send(pClientSocket[clientNumber], chunkData.c_str(), chunkData.length()+1);
+// if client is telling us where their ship is ("pos:<x>~<y>~")
+void ServerSocket::handlePosition(unsigned int clientNumber, std::string_view args) {
 
+	int x;
+	int y;
+	if (!parsePositionCommand(args, x, y)) {
+		return;
+	}
 
-		}
+	//only clients nearby get told what this client is up to from now on
+	interest.setClientPosition(clientNumber, x, y);
+	prefetchChunks(clientNumber, x, y);
 
-		// if client is attempting to login
-		if (bufferContents[0] == 'l' && bufferContents[1] == 'o' && bufferContents[2] == 'g' && bufferContents[3] == 't') {
+	//ships only get hit once we know who's flying them
+	if (players.hasName(clientNumber)) {
+		world.setShip(clientNumber, internPlayer(players.getName(clientNumber)), x, y);
+	}
 
-			//deleting 'log:'
-			bool foundPlayers = false;
+}
 
-			while (foundPlayers == false) {
+// if client has got a shot snapshot ("ack:<sequence>~"), see WireProtocol.h
+void ServerSocket::handleAck(unsigned int clientNumber, std::string_view args) {
 
-				if (bufferContents[0] != ':') {
-					bufferContents.erase(bufferContents.begin() + 0);
-				}
-				else {
-					foundPlayers = true;
-					bufferContents.erase(bufferContents.begin());
-				}
+	uint32_t sequence;
+	if (sessions[clientNumber].protocolVersion < 3 || !parseUint32(args.substr(0, args.find('~')), sequence)) {
+		return;
+	}
 
-			}
+	sessions[clientNumber].snapshots.acknowledge(sequence);
 
-			//getting out username
+}
 
-			bool foundUser2 = false;
-			string attemptedUsername = bufferContents;
-			bool holdv = false;
-			int usernameVariable = 0;
+// if client wants a UDP channel for position and shot updates ("udp~"), see WireProtocol.h
+void ServerSocket::handleUdp(unsigned int clientNumber, std::string_view) {
 
-			while (foundUser2 == false) {
+	//only binary clients who've said who they are get one (everything that goes over it is binary)
+	if (!udpOpen || sessions[clientNumber].protocolVersion == 0 || !players.hasName(clientNumber)) {
+		sendToClient(clientNumber, "udp:0~", 7);
+		return;
+	}
 
-				if (holdv) {
+	//asking again starts over with a new token
+	closeUdpChannel(clientNumber);
 
-					if (attemptedUsername[usernameVariable] == '~') {
-						foundUser2 = true;
-					}
+	uint64_t token;
+	do {
+		token = udpTokenSource();
+	} while (token == 0 || udpTokens.count(token) > 0);
 
-					attemptedUsername.erase(attemptedUsername.begin() + usernameVariable);
+	sessions[clientNumber].udpToken = token;
+	udpTokens[token] = clientNumber;
 
-				}
-				else {
+	char tokenText[17];
+	snprintf(tokenText, sizeof(tokenText), "%016llx", (unsigned long long)token);
 
-					if (attemptedUsername[usernameVariable] == '/') {
-						attemptedUsername.erase(attemptedUsername.begin() + usernameVariable);
-						usernameVariable--;
-						holdv = true;
-					}
-					usernameVariable++;
-				}
-			}
+	string reply = "udp:" + to_string(port) + "~" + tokenText + "~";
+	sendToClient(clientNumber, reply.c_str(), reply.length() + 1);
 
-			///// getting out password /////
-			bool foundPassword = false;
-			string attemptedPassword = bufferContents;
-			bool holdvPass = false;
-			int passwordVariable = 0;
+}
 
-			while (foundPassword == false) {
+// if client is attempting to login ("logt:<username>/<password>~")
+void ServerSocket::handleLogin(unsigned int clientNumber, std::string_view args) {
 
-				if (holdvPass == false) {
+	std::string_view attemptedUsername;
+	std::string_view attemptedPassword;
+	//(replies go with their terminator, sizeof includes it - without it they'd run into whatever's sent after them)
+	if (!parseCredentials(args, attemptedUsername, attemptedPassword)) {
+		sendToClient(clientNumber, "usrdec", sizeof("usrdec"));
+		return;
+	}
 
-					if (attemptedPassword[0] != '/') {
+	//checking if user is already logged on
+	bool playerAlreadyOn = players.isOnline(attemptedUsername);
 
-						attemptedPassword.erase(attemptedPassword.begin() + 0);
+	//if player is not already on
+	if (playerAlreadyOn == false) {
 
-					}
-					else {
-						holdvPass = true;
-						attemptedPassword.erase(attemptedPassword.begin() + 0);
+		//already checking a password for this client, the answer's on its way
+		if (sessions[clientNumber].passwordJob != 0) {
+			return;
+		}
 
-					}
-				}
-				else {
+		///// checking username and password against the accounts (on a password worker, it's slow on purpose)
+		const string *stored = accounts.find(attemptedUsername);
 
-					if (attemptedPassword[passwordVariable] == '~') {
-						foundPassword = true;
-						attemptedPassword.erase(attemptedPassword.begin() + passwordVariable);
-					}
-					else {
-						passwordVariable++;
-					}
+		if (stored != NULL) {
+			sessions[clientNumber].passwordJob = passwordWorkers.submitLogin(clientNumber, string(attemptedUsername), string(attemptedPassword), *stored);
+		}
 
-				}
+		//sending error message if user is not found in data (or the workers are too busy to check)
+		if (stored == NULL || sessions[clientNumber].passwordJob == 0) {
+			sendToClient(clientNumber, "usrdec", sizeof("usrdec"));
+		}
 
-			}
+	}
+	//if player is already logged on
+	else {
 
-			//bool for is player is already logged on
-			bool playerAlreadyOn = false;
+		sendToClient(clientNumber, "usralon", sizeof("usralon"));
 
-			//checking if user is already logged on
-			for (int i = 0; i < maxClients; i++) {
-				if (attemptedUsername == playerList[i]) {
-					playerAlreadyOn = true;
-				}
-			}
+	}
+}
 
-			//if player is not already on
-			if (playerAlreadyOn == false) {
+///// dealing with sign up request ("signup:<username>/<password>~") ///////
+void ServerSocket::handleSignup(unsigned int clientNumber, std::string_view args) {
 
-				///// checking username and password in database
-				std::ifstream userInfo;
+	std::string_view attemptedUsername;
+	std::string_view attemptedPassword;
+	if (!parseCredentials(args, attemptedUsername, attemptedPassword)) {
+		sendToClient(clientNumber, "signtaken", sizeof("signtaken"));
+		return;
+	}
 
-				userInfo.open("data/userInfo.txt", std::ifstream::in);
+	string username(attemptedUsername);
 
-				string getUsername = "";
-				string getPassword = "";
+	//telling user that username is taken (or can't be used)
+	if (sessions[clientNumber].passwordJob != 0 || accounts.exists(username) || pendingSignups.count(username) > 0
+		|| !AccountStore::isStorable(attemptedUsername) || !AccountStore::isStorable(attemptedPassword)) {
+		sendToClient(clientNumber, "signtaken", sizeof("signtaken"));
+		return;
+	}
 
-				//bool for seeing if user is found
-				bool userFound = false;
+	//the password gets hashed on a password worker, and the account's made when it's done
+	sessions[clientNumber].passwordJob = passwordWorkers.submitSignup(clientNumber, username, string(attemptedPassword));
 
-				while (userInfo.good()) {
+	if (sessions[clientNumber].passwordJob == 0) {
+		sendToClient(clientNumber, "signtaken", sizeof("signtaken"));
+	}
+	else {
+		pendingSignups.insert(username);
+	}
 
-					userInfo >> getUsername;
-					userInfo >> getPassword;
+}
 
-					if (getUsername == attemptedUsername && getPassword == attemptedPassword) {
+void ServerSocket::startPasswordWorkers(unsigned int numWorkers, unsigned int cost) {
+	passwordWorkers.setCost(cost);
+	passwordWorkers.start(numWorkers, [this] { pReactor->wake(); });
+}
 
-						userFound = true;
+void ServerSocket::collectPasswordResults() {
 
-						//telling user that their username and password is accepted
-						SDLNet_TCP_Send(pClientSocket[clientNumber], "usracpt", 7);
+	passwordResults.clear();
+	passwordWorkers.takeFinished(passwordResults);
 
-					}
+	for (unsigned int i = 0; i < passwordResults.size(); i++) {
+		const PasswordResult &result = passwordResults[i];
 
-				}
+		//new accounts (and plaintext passwords that have just been hashed) are saved whether or not the client's still here
+		if (result.accepted && !result.newSecret.empty()) {
+			accounts.set(result.username, result.newSecret);
+		}
 
-				//sending error message if user is not found in data
-				if (userFound == false) {
-					SDLNet_TCP_Send(pClientSocket[clientNumber], "usrdec", 6);
-				}
+		if (result.kind == PASSWORD_SIGNUP) {
+			pendingSignups.erase(result.username);
+		}
 
-				userInfo.close();
+		//only answer if it's still the same client waiting for it
+		unsigned int clientNumber = result.clientNumber;
+		if (sessions[clientNumber].free || sessions[clientNumber].passwordJob != result.id) {
+			continue;
+		}
+		sessions[clientNumber].passwordJob = 0;
 
+		if (result.kind == PASSWORD_SIGNUP) {
+			//telling user that their account has been created
+			if (result.accepted) {
+				sendToClient(clientNumber, "signacpt", sizeof("signacpt"));
 			}
-			//if player is already logged on
 			else {
-
-				SDLNet_TCP_Send(pClientSocket[clientNumber], "usralon", 7);
-
+				sendToClient(clientNumber, "signtaken", sizeof("signtaken"));
 			}
 		}
-		///// dealing with sign up request ///////
-		if (bufferContents[0] == 's' && bufferContents[1] == 'i' && bufferContents[2] == 'g' && bufferContents[3] == 'n' && bufferContents[4] == 'u' && bufferContents[5] == 'p') {
-			//deleting 'signup:'
-			bool foundPlayers = false;
-
-			while (foundPlayers == false) {
-
-				if (bufferContents[0] != ':') {
-					bufferContents.erase(bufferContents.begin() + 0);
-				}
-				else {
-					foundPlayers = true;
-					bufferContents.erase(bufferContents.begin());
-				}
-
+		else {
+			//telling user whether their username and password is accepted
+			if (result.accepted) {
+				sendToClient(clientNumber, "usracpt", sizeof("usracpt"));
+			}
+			else {
+				sendToClient(clientNumber, "usrdec", sizeof("usrdec"));
 			}
+		}
+	}
 
+}
 
-			//getting out username
 
-			bool foundUser2 = false;
-			string attemptedUsername = bufferContents;
-			bool holdv = false;
-			int usernameVariable = 0;
+	//sending message to all clients
+void ServerSocket::sendToClients(const string &s) {
 
-			while (foundUser2 == false) {
+	// build the message once, every client's queue just points at it
+	SharedPayload payload = makePayload(s.c_str(), s.length() + 1);
 
+	// Send message to all other connected clients
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
+	{
 
-				if (holdv) {
+		if (sessions[loop].free == false)
+		{
 
-					if (attemptedUsername[usernameVariable] == '~') {
-						foundUser2 = true;
-					}
+			sendToClient(loop, payload);
+		}
 
-					attemptedUsername.erase(attemptedUsername.begin() + usernameVariable);
+	}
 
-				}
-				else {
+}
 
-					if (attemptedUsername[usernameVariable] == '/') {
-						attemptedUsername.erase(attemptedUsername.begin() + usernameVariable);
-						usernameVariable--;
-						holdv = true;
-					}
-					usernameVariable++;
-				}
-			}
 
-			///// getting out password /////
-			bool foundPassword = false;
-			string attemptedPassword = bufferContents;
-			bool holdvPass = false;
-			int passwordVariable = 0;
+//sending message to one client (it's queued up and goes out when the tick is flushed, see flushClients)
+void ServerSocket::sendToClient(unsigned int clientNumber, const char *data, int length) {
 
-			while (foundPassword == false) {
+	if (sessions[clientNumber].free == false) {
 
-				if (holdvPass == false) {
+		// a client that's this far behind is getting dropped at the next flush, so don't bother queueing any more
+		if (sessions[clientNumber].outbound.getQueuedBytes() > OUTBOUND_HIGH_WATER) {
+			return;
+		}
 
-					if (attemptedPassword[0] != '/') {
+		sessions[clientNumber].outbound.append(sessions[clientNumber].framer.getMode(), data, length);
+	}
 
-						attemptedPassword.erase(attemptedPassword.begin() + 0);
+}
 
-					}
-					else {
-						holdvPass = true;
-						attemptedPassword.erase(attemptedPassword.begin() + 0);
+//sending a shared message to one client, without copying it
+void ServerSocket::sendToClient(unsigned int clientNumber, const SharedPayload &payload) {
 
-					}
-				}
-				else {
+	if (sessions[clientNumber].free == false) {
 
-					if (attemptedPassword[passwordVariable] == '~') {
-						foundPassword = true;
-						attemptedPassword.erase(attemptedPassword.begin() + passwordVariable);
-					}
-					else {
-						passwordVariable++;
-					}
+		if (sessions[clientNumber].outbound.getQueuedBytes() > OUTBOUND_HIGH_WATER) {
+			return;
+		}
 
-				}
+		sessions[clientNumber].outbound.append(sessions[clientNumber].framer.getMode(), payload);
+	}
 
-			}
+}
 
-			///// checking for username in database
-			std::ifstream userInfo;
+//sending a position or shot update to one client
+void ServerSocket::sendStateToClient(unsigned int clientNumber, const SharedPayload &payload) {
 
-			userInfo.open("data/userInfo.txt", std::ifstream::in);
+	if (sessions[clientNumber].free == true) {
+		return;
+	}
 
-			string getUsername = "";
-			string getPassword = "";
+	// no channel, or too big to go in a datagram with the header (5 bytes) and its length (2 bytes)? then it goes by TCP like anything else
+	if (!sessions[clientNumber].udpBound || payload->length() + 7 > MAX_UDP_DATAGRAM) {
+		sendToClient(clientNumber, payload);
+		return;
+	}
 
-			//bool for seeing if user is found
-			bool userTaken = false;
+	sessions[clientNumber].udpQueue.push_back(payload);
 
-			while (userInfo.good()) {
+}
 
-				userInfo >> getUsername;
-				userInfo >> getPassword;
+// Function to send the updates queued for a client's UDP channel, packed into as few datagrams as they'll fit in.
+// Each datagram gets the next sequence number so the client can throw away any that turn up late
+void ServerSocket::flushUdp(unsigned int clientNumber)
+{
+	Session &session = sessions[clientNumber];
 
-				if (getUsername == attemptedUsername) {
+	if (session.udpQueue.empty()) {
+		return;
+	}
 
-					userTaken = true;
+	udpSendBuffer.clear();
 
-				}
+	for (unsigned int i = 0; i < session.udpQueue.size(); i++)
+	{
+		const string &message = *session.udpQueue[i];
 
+		// Start a new datagram if this one won't fit in what we've got so far
+		if (!udpSendBuffer.empty() && udpSendBuffer.length() + message.length() + 2 > MAX_UDP_DATAGRAM)
+		{
+			if (pReactor->sendDatagram(session.udpAddress, udpSendBuffer.data(), (int)udpSendBuffer.length())) {
+				session.bytesOut += udpSendBuffer.length();
 			}
+			udpSendBuffer.clear();
+		}
 
-			//telling user that username is taken
-			if (userTaken) {
-				SDLNet_TCP_Send(pClientSocket[clientNumber], "signtaken", 9);
-			}
-			else {
-				//telling user that their account has been created
-				SDLNet_TCP_Send(pClientSocket[clientNumber], "signacpt", 8);
+		if (udpSendBuffer.empty()) {
+			beginUdpState(++session.udpSendSequence, udpSendBuffer);
+		}
 
-				//adding username and password to the end of data file
-				std::ofstream out;
-				out.open("data/userInfo.txt", std::ios::app);
-				out << attemptedUsername + " " + attemptedPassword << endl;
-				out.close();
+		appendUdpMessage(message.data(), message.length(), udpSendBuffer);
+	}
 
-			}
+	// A datagram that doesn't go is just lost, like any other - there'll be another update along shortly
+	if (pReactor->sendDatagram(session.udpAddress, udpSendBuffer.data(), (int)udpSendBuffer.length())) {
+		session.bytesOut += udpSendBuffer.length();
+	}
 
-			userInfo.close();
+	session.udpQueue.clear();
+}
 
+// Function to send everything queued up for each client, one send per client. Clients that can't keep up (more
+// than OUTBOUND_HIGH_WATER bytes waiting) or whose connection has broken are disconnected
+void ServerSocket::flushClients()
+{
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
+	{
+		if (sessions[loop].free == true)
+		{
+			continue;
+		}
 
+		if (sessions[loop].outbound.getQueuedBytes() > OUTBOUND_HIGH_WATER)
+		{
+			if (debug) { cout << "Client " << loop << " isn't keeping up with what we're sending, disconnecting." << endl; }
+			disconnectClient(loop, SESSION_TIMEOUT);
 		}
+		else
+		{
+			flushUdp(loop);
 
-	}
+			size_t queued = sessions[loop].outbound.getQueuedBytes();
 
-	// If the client told us to shut down the server, then set the flag to get us out of the main loop and shut down
-	if (bufferContents.compare(SHUTDOWN_SIGNAL) == 0)
-	{
-		shutdownServer = true;
+			if (!sessions[loop].outbound.flush(*pReactor, sessions[loop].socket))
+			{
+				if (debug) { cout << "Couldn't send to client " << loop << ", disconnecting." << endl; }
+				disconnectClient(loop);
+				continue;
+			}
 
-		if (debug) { cout << "Disconnecting all clients and shutting down the server..." << endl; }
+			sessions[loop].bytesOut += queued - sessions[loop].outbound.getQueuedBytes();
+		}
 	}
+}
 
-} // End of dealWithActivity function
+bool ServerSocket::openUdpChannels()
+{
+	udpOpen = pReactor->openUdp();
 
+	if (udpOpen) {
+		datagramBuffer.resize(64 * 1024);
+	}
 
-	//sending message to all clients
-void ServerSocket::sendToClients(string s) {
+	return udpOpen;
+}
 
-	unsigned int msgLength = strlen(s.c_str()) + 1;
+void ServerSocket::printSessionStats(std::ostream &out)
+{
+	unsigned long long bytesIn = 0;
+	unsigned long long bytesOut = 0;
+	unsigned long long messagesIn = 0;
 
-	// Send message to all other connected clients
-	for (unsigned int loop = 0; loop < maxClients; loop++)
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
 	{
-
-		if (pSocketIsFree[loop] == false)
+		if (sessions[loop].free == false)
 		{
-
-			SDLNet_TCP_Send(pClientSocket[loop], s.c_str(), msgLength);
+			bytesIn += sessions[loop].bytesIn;
+			bytesOut += sessions[loop].bytesOut;
+			messagesIn += sessions[loop].messagesIn;
 		}
-
 	}
 
+	out << "Sessions: " << clientCount << " connected (table " << sessions.size() << " of " << maxClients << "), "
+		<< messagesIn << " messages / " << bytesIn << " bytes in, " << bytesOut << " bytes out since they connected" << endl;
 }
 
 
-// Function to check all connected client sockets for activity
+// Function to check the client sockets the reactor reported as ready for activity
 // If we find a client with activity we return its number, or if there are
-// no clients with activity or we've processed all activity we return 0
+// no clients with activity or we've processed all activity we return -1
 int ServerSocket::checkForActivity()
 {
-	// Loop to check all possible client sockets for activity
-	for (unsigned int clientNumber = 0; clientNumber < maxClients; clientNumber++)
+	// Only look at the clients the reactor told us about, rather than every possible client socket
+	while (!readyClients.empty())
 	{
-		// If the socket is has activity then SDLNet_SocketReady() returns non-zero
-		int clientSocketActivity = SDLNet_SocketReady(pClientSocket[clientNumber]);
-
-		// The line below produces a LOT of debug, so only uncomment if the code's seriously misbehaving!
-		//cout << "Client number " << clientNumber << " has activity status: " << clientSocketActivity << endl;
+		unsigned int clientNumber = readyClients.back();
 
-		// If there is any activity on the client socket...
-		if (clientSocketActivity != 0)
+		// The client may have been disconnected since it was reported as ready
+		if (sessions[clientNumber].free)
 		{
-			// Check if the client socket has transmitted any data by reading from the socket and placing it in the buffer character array
-			int receivedByteCount = SDLNet_TCP_Recv(pClientSocket[clientNumber], pBuffer, bufferSize);
-
-			// If there's activity, but we didn't read anything from the client socket, then the client has disconnected...
-			if (receivedByteCount <= 0)
-			{
-					
-					//sending to other players that client left
-					playerLeaving(playerList[clientNumber]);
+			readyClients.pop_back();
+			continue;
+		}
 
-				//removing client from playerList
-				playerList[clientNumber] = "";
+		// Check if the client socket has transmitted any data by reading from the socket straight into the client's receive buffer
+		int freeSpace = 0;
+		char *writeSpace = sessions[clientNumber].framer.getWriteSpace(freeSpace);
 
-				//...so output a suitable message and then...
-				if (debug) { cout << "Client " << clientNumber << " disconnected." << endl; }
+		// No room left means the client has sent more than the largest message we allow without finishing it
+		int receivedByteCount = RECEIVE_CLOSED;
+		if (writeSpace != NULL)
+		{
+			receivedByteCount = pReactor->receive(sessions[clientNumber].socket, writeSpace, freeSpace);
+		}
 
-				//... remove the socket from the socket set, then close and reset the socket ready for re-use and finally...
-				SDLNet_TCP_DelSocket(socketSet, pClientSocket[clientNumber]);
-				SDLNet_TCP_Close(pClientSocket[clientNumber]);
-				pClientSocket[clientNumber] = NULL;
+		// The line below produces a LOT of debug, so only uncomment if the code's seriously misbehaving!
+		//cout << "Client number " << clientNumber << " received: " << receivedByteCount << endl;
 
-				// ...free up their slot so it can be reused...
-				pSocketIsFree[clientNumber] = true;
+		if (receivedByteCount > 0)
+		{
+			sessions[clientNumber].framer.commitWrite(receivedByteCount);
+			sessions[clientNumber].bytesIn += receivedByteCount;
 
-				// ...and decrement the count of connected clients.
-				clientCount--;
+			// ... return the active client number to be processed by the dealWithActivity function. We leave the client
+			// in the ready list, as the socket will only be reported again once it has been read until it would block
+			return clientNumber;
+		}
 
-				if (debug) { cout << "Server is now connected to: " << clientCount << " client(s)." << endl; }
-			}
-			else // If we read some data from the client socket...
-			{
-				// ... return the active client number to be processed by the dealWithActivity function
-				return clientNumber;
-			}
+		readyClients.pop_back();
 
-		} // End of if client socket is active check
+		// If there's activity, but the client socket has gone away, then the client has disconnected...
+		if (receivedByteCount == RECEIVE_CLOSED)
+		{
+			disconnectClient(clientNumber);
+		}
 
-	} // End of server socket check sockets loop
+	} // End of ready clients loop
 
 	// If we got here then there are no more clients with activity to process!
 	return -1;
 
 } // End of checkForActivity function
 
+// Function to drop a client and free up their slot
+void ServerSocket::disconnectClient(unsigned int clientNumber, int why)
+{
+	//sending to other players that client left (on the next tick)
+	if (players.hasName(clientNumber)) {
+		SessionEvent event;
+		event.kind = why;
+		event.clientNumber = clientNumber;
+		event.username = players.getName(clientNumber);
+		sessionEvents.push(event);
+	}
+
+	//removing client from the players
+	string name = players.getName(clientNumber);
+	players.clear(clientNumber);
+	releasePlayer(name);
+
+	//their ship is gone too
+	world.removeShip(clientNumber);
+	interest.removeClient(clientNumber);
+	chunkLoader.forgetClient(clientNumber);
+	prefetcher.removeClient(clientNumber);
+
+	//whatever they were logging in (or signing up) as finishes without them
+	sessions[clientNumber].passwordJob = 0;
+
+	//and their UDP channel closes with them
+	closeUdpChannel(clientNumber);
+
+	//...so output a suitable message and then...
+	if (debug) { cout << "Client " << clientNumber << " disconnected." << endl; }
+
+	//... stop watching the socket, then close and reset the socket ready for re-use and finally...
+	pReactor->removeClient(sessions[clientNumber].socket);
+	pReactor->closeClient(sessions[clientNumber].socket);
+	sessions[clientNumber].socket = NO_CLIENT;
+
+	// ...free up their slot so it can be reused...
+	sessions[clientNumber].free = true;
+	freeSlots.push_back(clientNumber);
+
+	// ...and decrement the count of connected clients.
+	clientCount--;
+
+	if (debug) { cout << "Server is now connected to: " << clientCount << " client(s)." << endl; }
+}
+
 // Function to return the shutdown status of the ServerSocket object
 bool ServerSocket::getShutdownStatus()
 {
 	return shutdownServer;
 }
 
-//when player leaves..
-void ServerSocket::playerLeaving(string s) {
+//telling everyone about players that have joined and left
+void ServerSocket::broadcastSessionEvents() {
+
+	// every "usrl:" goes in one batch, framed once for text clients and once for length prefixed ones
+	sessionTextBatch.clear();
+	sessionFramedBatch.clear();
+
+	SessionEvent event;
+	while (sessionEvents.pop(event)) {
+
+		if (event.kind == SESSION_JOIN) {
+			cout << event.username << " joined the game!" << endl;
+			continue;
+		}
+
+		if (event.kind == SESSION_TIMEOUT) {
+			cout << event.username << " wasn't keeping up, so was dropped." << endl;
+		}
+		cout << event.username << " left the game." << endl;
 
-	if (holdPlayerLeave1 == "") {
-		holdPlayerLeave1 = s;
+		//clients have always had the name followed by its '~'
+		string leaveMessage = "usrl:" + event.username + "~";
+		MessageFramer::appendFramed(FRAMING_TEXT, leaveMessage.c_str(), (int)leaveMessage.length() + 1, sessionTextBatch);
+		MessageFramer::appendFramed(FRAMING_LENGTH_PREFIXED, leaveMessage.c_str(), (int)leaveMessage.length() + 1, sessionFramedBatch);
 	}
-	else {
-		holdPlayerLeave2 = s;
+
+	if (sessionTextBatch.empty()) {
+		return;
 	}
-		//sendToClients("usrl:" + s);
 
-}
+	SharedPayload textBatch = makePayload(sessionTextBatch.c_str(), sessionTextBatch.length());
+	SharedPayload lengthPrefixedBatch = makePayload(sessionFramedBatch.c_str(), sessionFramedBatch.length());
 
-//setting player leave variable to ""
-void ServerSocket::setplayerLeaving1() {
-	holdPlayerLeave1 = "";
+	for (unsigned int loop = 0; loop < sessions.size(); loop++) {
+		if (sessions[loop].free == false && sessions[loop].outbound.getQueuedBytes() <= OUTBOUND_HIGH_WATER) {
+			sessions[loop].outbound.appendFramed(sessions[loop].framer.getMode() == FRAMING_TEXT ? textBatch : lengthPrefixedBatch);
+		}
+	}
 
 }
-void ServerSocket::setplayerLeaving2() {
-	holdPlayerLeave2 = "";
-}
 
 //updating shooting stuff
 void ServerSocket::updateShooting(){
 
-	if (shotX.size() > 0) {
-		string sendShoot = "shoot:";
+	// clients that get snapshots are sent any shot near them they haven't got, however long it's been flying
+	bool snapshotClients = false;
+	for (unsigned int loop = 0; loop < sessions.size(); loop++) {
+		if (sessions[loop].free == false && sessions[loop].protocolVersion >= 3) {
+			snapshotClients = true;
+			break;
+		}
+	}
 
+	// sort the recently fired shots (the only ones that get (re-)sent to everyone else, clients carry on flying them
+	// from there) by the chunk they're in, building each one's text and binary form once
+	shotsByChunk.clear();
 
-		//deleting vectors when shot time is excedded
-		for (int i = 0; i < shotX.size(); i++) {
+	for (unsigned int r = 0; r < shots.getRegionCount(); r++) {
+		const ShotStore &region = shots.getRegionShots(r);
 
-			//send initial shot parameters to players
+		for (unsigned int i = 0; i < region.size(); i++) {
 
-			sendShoot += "/";
-			sendShoot += "~uniname:" + uniqueName[i];
-			sendShoot += "~user:" + shotName[i];
-			sendShoot += "~shot:" + shotType[i];
-			sendShoot += "~xcor:" + to_string((int)shotX[i]);
-			sendShoot += "~ycor:" + to_string((int)shotY[i]);
-			sendShoot += "~rotat:" + to_string((int)shotRotation[i]) + "~";
-			sendShoot += "~xvshot:" + to_string(shotStartVelocityX[i]) + "~";
-			sendShoot += "~yvshot:" + to_string(shotStartVelocityY[i]) + "~";
-			sendShoot += "~timeshot:" + to_string(shotTime[i]) + "~";
-			sendShoot += "/";
+			bool recent = region.getAge(i) < SHOT_RESEND_SECONDS;
+			if (!recent && !snapshotClients) {
+				continue;
+			}
 
+			ChunkShots &chunk = shotsByChunk[chunkKey(chunkOf(region.getX(i)), chunkOf(region.getY(i)))];
+
+			// clients work out where a shot is from where it was fired plus velocity * timeshot, so send the
+			// starting point rather than where we've moved it to. Text clients work in frames: the velocity is per
+			// frame and timeshot is how many frames old the shot is (binary clients get the age in ms instead)
+			double velocityX = region.getVelocityX(i) / CLIENT_FRAMES_PER_SECOND;
+			double velocityY = region.getVelocityY(i) / CLIENT_FRAMES_PER_SECOND;
+			int startX = (int)(region.getX(i) - region.getVelocityX(i) * region.getAge(i));
+			int startY = (int)(region.getY(i) - region.getVelocityY(i) * region.getAge(i));
+
+			//binary form, which snapshots need for older shots too
+			WireShot wireShot;
+			wireShot.id = region.getId(i);
+			wireShot.playerId = region.getOwner(i);
+			wireShot.type = region.getTypeName(region.getType(i));
+			wireShot.x = startX;
+			wireShot.y = startY;
+			wireShot.rotation = (uint16_t)(((region.getRotation(i) % 360) + 360) % 360);
+			wireShot.velocityX = (int)velocityX;
+			wireShot.velocityY = (int)velocityY;
+			wireShot.timeMs = (uint32_t)(region.getAge(i) * 1000);
+
+			if (!recent) {
+				chunk.older.push_back(wireShot);
+				continue;
+			}
+			chunk.wire.push_back(wireShot);
+
+			//shot parameters for text clients (the unique name is the shot's id, "abc" is what clients expect on the end)
+			chunk.text += "/";
+			chunk.text += "~uniname:" + to_string(region.getId(i)) + "abc";
+			chunk.text += "~user:" + playerIdNames[region.getOwner(i)];
+			chunk.text += "~shot:" + region.getTypeName(region.getType(i));
+			chunk.text += "~xcor:" + to_string(startX);
+			chunk.text += "~ycor:" + to_string(startY);
+			chunk.text += "~rotat:" + to_string(region.getRotation(i)) + "~";
+			chunk.text += "~xvshot:" + to_string((int)velocityX) + "~";
+			chunk.text += "~yvshot:" + to_string((int)velocityY) + "~";
+			chunk.text += "~timeshot:" + to_string(region.getAge(i) * CLIENT_FRAMES_PER_SECOND) + "~";
+			chunk.text += "/";
 		}
+	}
 
-		// Send message to all other connected clients
-		for (unsigned int loop = 0; loop < maxClients; loop++)
-		{
+	if (shotsByChunk.empty()) {
+		return;
+	}
 
-			if (pSocketIsFree[loop] == false)
-			{
+	// Send each client the shots in and around their chunk (or all of them if we don't know where they are).
+	// Everyone in the same chunk gets the same message, so each one is built once and shared between them
+	textPayloads.clear();
+	binaryPayloads.clear();
+	SharedPayload allText;
+	SharedPayload allBinary;
+	int64_t nearby[9];
 
-				unsigned int msgLength = strlen(sendShoot.c_str()) + 1;
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
+	{
+		if (sessions[loop].free == true) {
+			continue;
+		}
 
-				SDLNet_TCP_Send(pClientSocket[loop], sendShoot.c_str(), msgLength);
-			}
+		bool binary = sessions[loop].protocolVersion > 0;
+		bool placed = interest.getNearbyChunks(loop, nearby);
 
+		if (sessions[loop].protocolVersion >= 3) {
+			sendShotSnapshot(loop, placed ? nearby : NULL);
+			continue;
+		}
+
+		SharedPayload *payload;
+		if (placed) {
+			// the middle one of the nine is the client's own chunk
+			payload = binary ? &binaryPayloads[nearby[4]] : &textPayloads[nearby[4]];
+		}
+		else {
+			payload = binary ? &allBinary : &allText;
+		}
+
+		if (!*payload) {
+			*payload = buildShotPayload(binary, placed ? nearby : NULL);
+		}
+
+		//shots get sent again and again until they expire, so binary clients can have them by UDP
+		if ((*payload)->length() > 0 && binary) {
+			sendStateToClient(loop, *payload);
+		}
+		else if ((*payload)->length() > 0) {
+			sendToClient(loop, *payload);
 		}
 	}
 }
 
-//used to make sure shots are sent
-void ServerSocket::updateShooting2() {
-		updateShooting();
-
-	//duplicate needed to delete first shot of vector
-	for (int i = 0; i < shotX.size(); i++) {
-		//delete shot on server
-		shotX.erase(shotX.begin() + i);
-		shotY.erase(shotY.begin() + i);
-		shotName.erase(shotName.begin() + i);
-		shotRotation.erase(shotRotation.begin() + i);
-		shotType.erase(shotType.begin() + i);
-		shotTime.erase(shotTime.begin() + i);
-		uniqueName.erase(uniqueName.begin() + i);
-		shotStartVelocityX.erase(shotStartVelocityX.begin() + i);
-		shotStartVelocityY.erase(shotStartVelocityY.begin() + i);
-	}
-
-	for (int i = 0; i < shotX.size(); i++) {
-		//delete shot on server
-		shotX.erase(shotX.begin() + i);
-		shotY.erase(shotY.begin() + i);
-		shotName.erase(shotName.begin() + i);
-		shotRotation.erase(shotRotation.begin() + i);
-		shotType.erase(shotType.begin() + i);
-		shotTime.erase(shotTime.begin() + i);
-		uniqueName.erase(uniqueName.begin() + i);
-		shotStartVelocityX.erase(shotStartVelocityX.begin() + i);
-		shotStartVelocityY.erase(shotStartVelocityY.begin() + i);
-	}
-}
\ No newline at end of file
+//putting together the shots near a chunk (or all of them if nearby is NULL) as one message, empty if there aren't any
+SharedPayload ServerSocket::buildShotPayload(bool binary, const int64_t *nearby) {
+
+	string sendShoot = "shoot:";
+	string sendShootBinary;
+	vector<WireShot> wireShots;
+
+	for (unordered_map<int64_t, ChunkShots>::const_iterator chunk = shotsByChunk.begin(); chunk != shotsByChunk.end(); chunk++) {
+
+		if (nearby != NULL && std::find(nearby, nearby + 9, chunk->first) == nearby + 9) {
+			continue;
+		}
+
+		if (binary) {
+			wireShots.insert(wireShots.end(), chunk->second.wire.begin(), chunk->second.wire.end());
+		}
+		else {
+			sendShoot += chunk->second.text;
+		}
+	}
+
+	if (binary) {
+		if (wireShots.empty()) {
+			return makePayload("", 0);
+		}
+		encodeShotBatch(wireShots, sendShootBinary);
+		return makePayload(sendShootBinary.c_str(), sendShootBinary.length());
+	}
+
+	if (sendShoot.length() == 6) {
+		return makePayload("", 0);
+	}
+	return makePayload(sendShoot.c_str(), sendShoot.length() + 1);
+}
+
+//sending one client the shots near them (or all of them if nearby is NULL) that weren't in the last snapshot they acknowledged
+void ServerSocket::sendShotSnapshot(unsigned int clientNumber, const int64_t *nearby) {
+
+	snapshotShots.clear();
+
+	for (unordered_map<int64_t, ChunkShots>::const_iterator chunk = shotsByChunk.begin(); chunk != shotsByChunk.end(); chunk++) {
+
+		if (nearby != NULL && std::find(nearby, nearby + 9, chunk->first) == nearby + 9) {
+			continue;
+		}
+
+		snapshotShots.insert(snapshotShots.end(), chunk->second.wire.begin(), chunk->second.wire.end());
+		snapshotShots.insert(snapshotShots.end(), chunk->second.older.begin(), chunk->second.older.end());
+	}
+
+	// in id order, to compare with the snapshot they acknowledged
+	std::sort(snapshotShots.begin(), snapshotShots.end(), [](const WireShot &a, const WireShot &b) { return a.id < b.id; });
+
+	snapshotIds.clear();
+	for (unsigned int i = 0; i < snapshotShots.size(); i++) {
+		snapshotIds.push_back(snapshotShots[i].id);
+	}
+
+	SnapshotHistory &history = sessions[clientNumber].snapshots;
+	history.findMissing(snapshotIds, snapshotMissing);
+
+	//they've got them all already
+	if (snapshotMissing.empty()) {
+		return;
+	}
+
+	snapshotDelta.clear();
+	for (unsigned int i = 0; i < snapshotMissing.size(); i++) {
+		snapshotDelta.push_back(snapshotShots[snapshotMissing[i]]);
+	}
+
+	uint32_t sequence = history.record(snapshotIds);
+
+	snapshotBuffer.clear();
+	encodeShotSnapshot(sequence, snapshotDelta, snapshotBuffer);
+	sendStateToClient(clientNumber, makePayload(snapshotBuffer.c_str(), snapshotBuffer.length()));
+}
+
+//telling everyone nearby about shots that hit something or ran out of time this tick
+void ServerSocket::sendShotEvents() {
+
+	if (shotEvents.empty()) {
+		return;
+	}
+
+	// "shotevt:/~uniname:<id>abc~event:<expire|ship|planet>~target:<player or planet>~xcor:<x>~ycor:<y>~/..."
+	// sorted by chunk, like the shots
+	eventsByChunk.clear();
+
+	for (unsigned int i = 0; i < shotEvents.size(); i++) {
+
+		const ShotEvent &event = shotEvents[i];
+		ChunkShotEvents &chunk = eventsByChunk[chunkKey(chunkOf(event.x), chunkOf(event.y))];
+
+		chunk.text += "/";
+		chunk.text += "~uniname:" + to_string(event.id) + "abc";
+
+		if (event.kind == SHOT_HIT_SHIP) {
+			chunk.text += "~event:ship~target:" + playerIdNames[event.target];
+		}
+		else if (event.kind == SHOT_HIT_PLANET) {
+			chunk.text += "~event:planet~target:" + to_string(event.target);
+		}
+		else {
+			chunk.text += "~event:expire";
+		}
+
+		chunk.text += "~xcor:" + to_string((int)event.x);
+		chunk.text += "~ycor:" + to_string((int)event.y) + "~";
+		chunk.text += "/";
+
+		WireShotEvent wireEvent;
+		wireEvent.id = event.id;
+		wireEvent.kind = event.kind;
+		wireEvent.target = event.target;
+		wireEvent.x = (int)event.x;
+		wireEvent.y = (int)event.y;
+		chunk.wire.push_back(wireEvent);
+	}
+
+	// same as the shots, each different neighbourhood's message is built once and shared
+	textPayloads.clear();
+	binaryPayloads.clear();
+	SharedPayload allText;
+	SharedPayload allBinary;
+	int64_t nearby[9];
+
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
+	{
+		if (sessions[loop].free == true) {
+			continue;
+		}
+
+		// version 1 binary clients don't know about WIRE_MSG_SHOT_EVENTS, so they get the text version
+		bool binary = sessions[loop].protocolVersion >= 2;
+		bool placed = interest.getNearbyChunks(loop, nearby);
+
+		SharedPayload *payload;
+		if (placed) {
+			payload = binary ? &binaryPayloads[nearby[4]] : &textPayloads[nearby[4]];
+		}
+		else {
+			payload = binary ? &allBinary : &allText;
+		}
+
+		if (!*payload) {
+			*payload = buildShotEventPayload(binary, placed ? nearby : NULL);
+		}
+
+		if ((*payload)->length() > 0) {
+			sendToClient(loop, *payload);
+		}
+	}
+}
+
+//putting together the shot events near a chunk (or all of them if nearby is NULL) as one message, empty if there aren't any
+SharedPayload ServerSocket::buildShotEventPayload(bool binary, const int64_t *nearby) {
+
+	string sendEvents = "shotevt:";
+	string sendEventsBinary;
+	vector<WireShotEvent> wireEvents;
+
+	for (unordered_map<int64_t, ChunkShotEvents>::const_iterator chunk = eventsByChunk.begin(); chunk != eventsByChunk.end(); chunk++) {
+
+		if (nearby != NULL && std::find(nearby, nearby + 9, chunk->first) == nearby + 9) {
+			continue;
+		}
+
+		if (binary) {
+			wireEvents.insert(wireEvents.end(), chunk->second.wire.begin(), chunk->second.wire.end());
+		}
+		else {
+			sendEvents += chunk->second.text;
+		}
+	}
+
+	if (binary) {
+		if (wireEvents.empty()) {
+			return makePayload("", 0);
+		}
+		encodeShotEvents(wireEvents, sendEventsBinary);
+		return makePayload(sendEventsBinary.c_str(), sendEventsBinary.length());
+	}
+
+	if (sendEvents.length() == 8) {
+		return makePayload("", 0);
+	}
+	return makePayload(sendEvents.c_str(), sendEvents.length() + 1);
+}
+
+//get the small id used for a player in binary messages, handing out one if they haven't got one
+//(only for names from players.setName - anything a client claims to be isn't to be trusted)
+unsigned int ServerSocket::internPlayer(const string &username) {
+
+	unordered_map<string, unsigned int>::iterator found = playerIds.find(username);
+	if (found != playerIds.end()) {
+		return found->second;
+	}
+
+	unsigned int id;
+	if (!freePlayerIds.empty()) {
+		id = freePlayerIds.front();
+		freePlayerIds.pop_front();
+		playerIdNames[id] = username;
+	}
+	else {
+		id = playerIdNames.size();
+		playerIdNames.push_back(username);
+	}
+	playerIds[username] = id;
+
+	//let the binary clients know who the new id belongs to
+	vector<WirePlayerName> names(1);
+	names[0].id = id;
+	names[0].name = username;
+
+	string namesMessage;
+	encodePlayerNames(names, namesMessage);
+	SharedPayload payload = makePayload(namesMessage.c_str(), namesMessage.length());
+
+	for (unsigned int loop = 0; loop < sessions.size(); loop++)
+	{
+		if (sessions[loop].free == false && sessions[loop].protocolVersion > 0)
+		{
+			sendToClient(loop, payload);
+		}
+	}
+
+	return id;
+}
+
+//give up a player's id if nobody's playing as them any more
+void ServerSocket::releasePlayer(const string &username) {
+
+	if (username.empty() || players.isOnline(username)) {
+		return;
+	}
+
+	unordered_map<string, unsigned int>::iterator found = playerIds.find(username);
+	if (found == playerIds.end()) {
+		return;
+	}
+
+	freePlayerIds.push_back(found->second);
+	playerIds.erase(found);
+}
+
+//moving every shot along, working out what they've hit and telling everyone, then sending the shots that are still flying
+void ServerSocket::updateShooting2(double elapsedSeconds) {
+
+	//shots that hit a ship or planet are done with, and so are shots that have run out of time
+	shotEvents.clear();
+	shots.tick(elapsedSeconds, world, shotEvents);
+
+	sendShotEvents();
+	updateShooting();
+}
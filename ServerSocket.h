@@ -6,7 +6,28 @@
 #include <sstream>
 #include "SDL_net.h"
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <random>
+#include <deque>
 #include "SocketException.h" // Include our custom exception header which defines an inline class
+#include "EventReactor.h"    // epoll (or SDL_net socket set) wrapper which tells us which sockets are ready
+#include "MessageFramer.h"   // Per-client receive buffers which split the incoming byte stream into messages
+#include "OutboundQueue.h"   // Per-client send buffers, flushed once per tick
+#include "Session.h"         // Everything about one client connection
+#include "WireProtocol.h"    // Binary encoding for shot and position traffic
+#include "CommandDispatcher.h" // Table of handlers for the "!command" messages
+#include "RegionSimulation.h" // Every shot in flight, split into regions simulated on worker threads
+#include "CollisionWorld.h"  // Ships and planets for shots to hit
+#include "Chunk.h"           // Chunk size and coordinate helpers
+#include "AreaOfInterest.h"  // Which chunk each client is in, so traffic only goes to clients nearby
+#include "ChunkCache.h"      // Recently loaded chunks, ready to send
+#include "ChunkLoader.h"     // Loads and makes chunks on worker threads
+#include "ChunkPrefetcher.h"  // Guesses which chunks each client will want next
+#include "AccountStore.h"     // Every player's username and password
+#include "PasswordWorkers.h"  // Hashes and checks passwords on worker threads
+#include "PlayerDirectory.h"  // Which player is in which client slot
+#include "SessionEvents.h"    // Players joining and leaving, told to everyone once a tick
 
 using std::string;
 using std::cout;
@@ -19,87 +40,236 @@ private:
 	bool debug = false;                 // Flag to control whether the ServerSocket should display debug info
 
 	unsigned int port;          // The port our server will listen for incoming connecions on
-	unsigned int bufferSize;    // Size of our message buffer
+	unsigned int bufferSize;    // Initial size of each client's receive buffer (it grows up to MAX_MESSAGE_SIZE)
 	unsigned int maxSockets;    // Max number of sockets
 	unsigned int maxClients;    // Max number of clients in our socket set (defined as maxSockets - 1 as the server socket itself take 1 port)
 
-	IPaddress serverIP;         // The IP of the socket server (this will end up being 0.0.0.0 - which means roughly "any IP address")
-	TCPsocket serverSocket;     // The server socket that clients will connect to
-	string    dotQuadString;    // The IP address of the server as a dot-quad string i.e. "127.0.0.1"
+	EventReactor *pReactor;     // Owns the listening socket and tells us which client sockets have activity
 
-	// These must be pointers because we don't know the array size until the SocketServer object is created!
-	// Note: These pointers are made into arrays in the ServerSocket constructor!
-	TCPsocket *pClientSocket;   // A pointer to (what will be) an array of sockets for the clients
-	bool *pSocketIsFree;        // A pointer to (what will be) an array of flags indicating which client sockets are free
-	char *pBuffer;              // A pointer to (what will be) an array of characters used to store the messages we receive
+	// Every client's connection, indexed by client slot. Grows (up to maxClients) as more clients are connected at once
+	std::vector<Session> sessions;
 
-	SDLNet_SocketSet socketSet; // Our entire set of sockets
+	std::vector<int> readyClients; // Client slots reported ready by the reactor which still have data to be read
+	std::vector<unsigned int> freeSlots; // Slots in the session table that clients have left, the next one to hand out on the end
 
 	unsigned int clientCount;   // Count of how many clients are currently connected to the server
 
 	bool shutdownServer;        // Flag to control when to shut down the server
 
-	string playerList[100]; //list of players
+	// Function to do something with a single message received from a client
+	void dealWithMessage(unsigned int clientNumber, std::string_view message);
 
+	// Handlers for each "!command", registered with the dispatcher in the constructor
+	CommandDispatcher<ServerSocket> commands;
+	void handleFrame(unsigned int clientNumber, std::string_view args);
+	void handleProto(unsigned int clientNumber, std::string_view args);
+	void handleUse(unsigned int clientNumber, std::string_view args);
+	void handleShoot(unsigned int clientNumber, std::string_view args);
+	void handleLoadChunk(unsigned int clientNumber, std::string_view args);
+	void handlePosition(unsigned int clientNumber, std::string_view args);
+	void handleUdp(unsigned int clientNumber, std::string_view args);
+	void handleAck(unsigned int clientNumber, std::string_view args);
 
-	//vectors for shooting
-	std::vector<double> shotX;
-	std::vector<double> shotY;
-	std::vector<string> shotName;
-	std::vector<int> shotRotation;
-	std::vector<string> shotType;
-	std::vector<double> shotTime;
-	std::vector<string> uniqueName;
-	std::vector<int> shotStartVelocityX;
-	std::vector<int> shotStartVelocityY;
+	//UDP channels for position and shot updates (see WireProtocol.h)
+	bool udpOpen;
+	std::mt19937_64 udpTokenSource;
+	std::unordered_map<uint64_t, unsigned int> udpTokens;    // Token -> client slot, for clients that haven't said hello yet
+	std::unordered_map<uint64_t, unsigned int> udpClients;   // udpAddressKey -> client slot
+	std::vector<char> datagramBuffer;
+	std::vector<WireSlice> datagramMessages;
+	string udpSendBuffer;
+	void readDatagrams();
+	void dealWithDatagram(const char *data, int length, const UdpAddress &from);
+	void closeUdpChannel(unsigned int clientNumber);
+	void flushUdp(unsigned int clientNumber);
+
+	//sending a position or shot update, by UDP if the client has a channel (and it fits in a datagram), otherwise like any other message
+	void sendStateToClient(unsigned int clientNumber, const SharedPayload &payload);
+
+	//chunks that have been asked for lately, and loading (or making) the ones that aren't
+	ChunkCache chunkCache;
+	ChunkLoader chunkLoader;
+	std::vector<LoadedChunk> loadedChunks;      // Reused for collecting finished chunks from the loader
+	std::vector<unsigned int> chunkWaiters;     // Reused for the clients waiting on each of them
+	std::vector<int64_t> planetChunks;          // Reused for going through the chunks the collision world has planets for
+
+	//loading chunks before clients get to them, so fast ships don't see planets pop in
+	ChunkPrefetcher prefetcher;
+	bool prefetchEnabled;
+	bool pushPrefetched;                        // Send clients the chunks they've come near without waiting for !loadchunk
+	std::vector<int64_t> prefetchWarm;
+	std::vector<int64_t> prefetchEntered;
+	void prefetchChunks(unsigned int clientNumber, double x, double y);
+	AccountStore accounts;
+	PasswordWorkers passwordWorkers;
+	std::unordered_set<std::string> pendingSignups;   // Usernames being signed up right now, so nobody else can take them
+	std::vector<PasswordResult> passwordResults;      // Reused for collecting finished jobs from the workers
+	void handleLogin(unsigned int clientNumber, std::string_view args);
+	void handleSignup(unsigned int clientNumber, std::string_view args);
+
+	string relayBuffer;         // Reused for building every relayed message
+
+	// Function to drop a client and free up their slot
+	void disconnectClient(unsigned int clientNumber, int why = SESSION_LEAVE);
+
+	PlayerDirectory players;    //who's playing in each slot, and which slot each player's in
+
+	SessionEventQueue sessionEvents;   //joins and leaves since the last broadcastSessionEvents()
+	string sessionTextBatch;           //reused for building the broadcast, for text clients...
+	string sessionFramedBatch;         //...and for length prefixed ones
+
+	//small ids handed out to players so binary messages don't have to repeat usernames. Only players that are on
+	//have one - when nobody's playing as a name any more its id goes back on the free list for someone else
+	std::unordered_map<string, unsigned int> playerIds;
+	std::vector<string> playerIdNames;          //by id, still holding the last name given it until it's reused
+	std::deque<unsigned int> freePlayerIds;     //oldest first, so shots still flying with an old id have longest to finish
+	unsigned int internPlayer(const string &username);
+	void releasePlayer(const string &username);
+
+
+	//every shot currently flying, by region
+	RegionSimulation shots;
+
+	//ships and planets shots can hit
+	CollisionWorld world;
+
+	//shots that hit something or expired this tick
+	std::vector<ShotEvent> shotEvents;
+	void sendShotEvents();
+
+	//which chunk everyone is in, and who to send each relayed message to
+	AreaOfInterest interest;
+	std::vector<unsigned int> recipients;
+
+	//shots (and shot events) sorted by the chunk they're in, in both encodings, so each client can be sent just the nearby ones
+	struct ChunkShots {
+		string text;
+		std::vector<WireShot> wire;
+		std::vector<WireShot> older;    // shots past resending to clients that don't get snapshots, which snapshots still need
+	};
+	struct ChunkShotEvents {
+		string text;
+		std::vector<WireShotEvent> wire;
+	};
+	std::unordered_map<int64_t, ChunkShots> shotsByChunk;
+	std::unordered_map<int64_t, ChunkShotEvents> eventsByChunk;
+
+	//messages already built for clients in each chunk, so everyone in the same chunk shares one
+	std::unordered_map<int64_t, SharedPayload> textPayloads;
+	std::unordered_map<int64_t, SharedPayload> binaryPayloads;
+	SharedPayload buildShotPayload(bool binary, const int64_t *nearby);
+
+	//shots for clients that get snapshots (see SnapshotHistory.h), only the ones they haven't acknowledged having
+	std::vector<WireShot> snapshotShots;
+	std::vector<uint32_t> snapshotIds;
+	std::vector<unsigned int> snapshotMissing;
+	std::vector<WireShot> snapshotDelta;
+	string snapshotBuffer;
+	void sendShotSnapshot(unsigned int clientNumber, const int64_t *nearby);
+	SharedPayload buildShotEventPayload(bool binary, const int64_t *nearby);
 public:
 
 	void updateShooting();
 
-	string holdPlayerLeave1 = "";
-	string holdPlayerLeave2 = "";
-
 	//get client count
 	int getClientCount() { return clientCount; }
 
-	//get playerLeaving 1
-	string getLeavePlayer1() { return holdPlayerLeave1; }
-	//get playerLeaving 1
-	string getLeavePlayer2() { return holdPlayerLeave2; }
-
-	//reseting player leaveing to ""
-	void setplayerLeaving1();
-	void setplayerLeaving2();
+	//tell everyone about every player that's left since last time, in one message per client - call once per tick
+	void broadcastSessionEvents();
 
 	static const string SERVER_NOT_FULL;
 	static const string SERVER_FULL;
 	static const string SHUTDOWN_SIGNAL;
+	static const unsigned int MAX_MESSAGE_SIZE;
+	static const unsigned int OUTBOUND_HIGH_WATER; // Most bytes we'll hold for a client before deciding they can't keep up
+	static const unsigned int DEFAULT_CHUNK_CACHE_SIZE;
+	static const unsigned int DEFAULT_WORLD_SEED;
+	static const unsigned int DEFAULT_PLANETS_PER_CHUNK;
+	static const unsigned int DEFAULT_PLANET_SPACING;
+	static const unsigned int DEFAULT_PREFETCH_SECONDS;
+	static const unsigned int INITIAL_SESSIONS;    // Room made in the session table up front
 
 	ServerSocket(unsigned int port, unsigned int bufferSize, unsigned int maxSockets);
 
 	~ServerSocket();
 
-	// Function to poll for clients connecting
-	void checkForConnections();
+	// Function to wait (for up to timeoutMs) for socket activity and accept any clients connecting
+	void checkForConnections(int timeoutMs);
 
-	//used to make sure shots are recieved
-	void updateShooting2();
+	//moves the shots on by elapsedSeconds, sends out what they hit (or that they expired), then sends the shots still flying
+	void updateShooting2(double elapsedSeconds);
 
 	// Function to poll for client activity (i.e. message sent or dropped connection)
 	// Returns either the number of an active client, or -1 if no clients with activity to process
 	int checkForActivity();
 
-	// Function to actually do something when client activity is detected!
+	// Function to actually do something when client activity is detected! (handles every complete message received)
 	void dealWithActivity(unsigned int clientNumber);
 
 	// Function to return the shutdown status, used to control when to terminate
 	bool getShutdownStatus();
 
 	//sending data to every client
-	void sendToClients(string s);
+	void sendToClients(const string &s);
+
+	//sending data to one client (queued until the next flushClients)
+	void sendToClient(unsigned int clientNumber, const char *data, int length);
+
+	//sending a message built once for lots of clients (queued by reference, not copied)
+	void sendToClient(unsigned int clientNumber, const SharedPayload &payload);
+
+	// Function to send everything queued for each client - call once per tick
+	void flushClients();
+
+	//how many chunk replies to keep in memory, and how well that's working
+	void setChunkCacheSize(unsigned int chunks) { chunkCache.setCapacity(chunks); }
+
+	//which universe we're in - the same seed always makes the same chunks
+	void setWorldSeed(unsigned int seed) { chunkLoader.setWorldSeed(seed); }
+
+	//how many planets go in each chunk, and how far apart they have to be
+	void setPlanetLayout(unsigned int planetsPerChunk, unsigned int planetSpacing) {
+		chunkLoader.setNumPlanets(planetsPerChunk);
+		chunkLoader.setPlanetSpacing(planetSpacing);
+	}
+	ChunkCache &getChunkCache() { return chunkCache; }
+	ChunkLoader &getChunkLoader() { return chunkLoader; }
+
+	//how many clients are connected, how big the session table's got, and their traffic
+	void printSessionStats(std::ostream &out);
+
+	//load the chunks around (and ahead of) each client before it asks, and whether to send them unasked too
+	void setChunkPrefetch(bool enabled, unsigned int lookaheadSeconds, bool push) {
+		prefetchEnabled = enabled;
+		prefetcher.setLookaheadSeconds(lookaheadSeconds);
+		pushPrefetched = push;
+	}
+
+	//load chunks on this many threads (call after the settings above). 0 loads them on the network thread
+	void startChunkWorkers(unsigned int numWorkers);
+
+	//open the UDP socket (on the same port number) so clients can ask for UDP channels. Returns false if it couldn't be opened
+	bool openUdpChannels();
+
+	//accept connections on this many threads of their own (see EventReactor::startAcceptors). Returns false if that's not supported here
+	bool startAcceptors(unsigned int numAcceptors) { return pReactor->startAcceptors(numAcceptors); }
+
+	//simulate shots on this many threads as well as the network thread. 0 does it all on the network thread
+	void startSimulationThreads(unsigned int numThreads) { shots.start(numThreads); }
+
+	//check passwords on this many threads, at this scrypt cost (see PasswordHash.h). 0 threads checks them on the network thread
+	void startPasswordWorkers(unsigned int numWorkers, unsigned int cost);
+
+	//answer the logins and signups the password workers have finished - call every time round the main loop
+	void collectPasswordResults();
+
+	//cache the chunks the workers have finished and send them to whoever asked - call every time round the main loop
+	void collectLoadedChunks();
+
+	//stop testing shots against the planets of chunks that have been evicted from the chunk cache and that nobody's
+	//near any more - call every so often
+	void forgetUnusedPlanets();
 
-	//player left
-	void playerLeaving(string s);
 
 };
 
@@ -0,0 +1,42 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstdint>
+#include <vector>
+#include "EventReactor.h"
+#include "MessageFramer.h"
+#include "OutboundQueue.h"
+#include "SnapshotHistory.h"
+
+// Everything about one client connection, kept together so each client's state is one entry in ServerSocket's
+// session table (indexed by client slot) rather than spread over an array per field. Who's playing in the slot and
+// which chunk they're in are kept by PlayerDirectory and AreaOfInterest, which index them both ways round.
+struct Session
+{
+	ClientHandle socket;        // NO_CLIENT while the slot's free
+	bool free;                  // Nobody's connected in this slot
+	MessageFramer framer;       // What they've sent that we haven't dealt with yet
+	OutboundQueue outbound;     // What we've sent them this tick
+	int protocolVersion;        // Binary protocol version they speak (0 for text only)
+	uint64_t passwordJob;       // The login/signup they're waiting on (0 for none)
+
+	// Their UDP channel, if they've asked for one (see WireProtocol.h)
+	uint64_t udpToken;          // What their hello has to carry (0 if they haven't asked)
+	bool udpBound;              // We know which address their datagrams come from
+	UdpAddress udpAddress;
+	uint32_t udpSendSequence;   // Last sequence number we sent them
+	uint32_t udpReceiveSequence; // Newest one we've had from them (anything older is dropped)
+	std::vector<SharedPayload> udpQueue; // Updates to go in the next datagram(s)
+
+	SnapshotHistory snapshots;  // Shot snapshots we've sent them lately (version 3 and up)
+
+	// Traffic since they connected
+	unsigned long long bytesIn;
+	unsigned long long bytesOut;
+	unsigned long long messagesIn;
+
+	Session() : socket(NO_CLIENT), free(true), protocolVersion(0), passwordJob(0), udpToken(0), udpBound(false), udpAddress(),
+		udpSendSequence(0), udpReceiveSequence(0), bytesIn(0), bytesOut(0), messagesIn(0) {}
+};
+
+#endif
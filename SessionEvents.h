@@ -0,0 +1,25 @@
+#ifndef SESSION_EVENTS_H
+#define SESSION_EVENTS_H
+
+#include <string>
+#include "MpscQueue.h"
+
+enum SessionEventKind
+{
+	SESSION_JOIN = 0,       // A client picked a player name (!use)
+	SESSION_LEAVE = 1,      // A client disconnected
+	SESSION_TIMEOUT = 2     // A client was dropped for not keeping up with what we're sending it
+};
+
+// Something that happened to a player's session. Queued by whichever thread sees it, and read once per tick by the
+// network thread, which tells everyone about the lot in one broadcast.
+struct SessionEvent
+{
+	int kind;
+	unsigned int clientNumber;
+	std::string username;
+};
+
+typedef MpscQueue<SessionEvent> SessionEventQueue;
+
+#endif
@@ -0,0 +1,169 @@
+#include "ShotStore.h"
+
+uint8_t ShotStore::registerType(const std::string &name, double lifetimeSeconds)
+{
+	typeNames.push_back(name);
+	typeLifetime.push_back(lifetimeSeconds);
+	return (uint8_t)(typeNames.size() - 1);
+}
+
+int ShotStore::findType(const std::string &name) const
+{
+	for (unsigned int i = 0; i < typeNames.size(); i++)
+	{
+		if (typeNames[i] == name) { return (int)i; }
+	}
+	return -1;
+}
+
+ShotHandle ShotStore::spawn(uint8_t typeId, uint32_t ownerId, double startX, double startY, int startRotation, double startVelocityX, double startVelocityY,
+	uint32_t shotId, double startAge)
+{
+	uint32_t slot;
+
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		if (slotDenseIndex.size() > SHOT_INDEX_MASK) { return NO_SHOT; }
+
+		slot = (uint32_t)slotDenseIndex.size();
+		slotDenseIndex.push_back(0);
+		slotGeneration.push_back(0);
+	}
+
+	// The generation wraps within the bits left over from the index
+	ShotHandle handle = (slotGeneration[slot] << SHOT_INDEX_BITS) | slot;
+	if (handle == NO_SHOT)
+	{
+		slotGeneration[slot] = 0;
+		handle = slot;
+	}
+
+	slotDenseIndex[slot] = (uint32_t)handles.size();
+
+	x.push_back(startX);
+	y.push_back(startY);
+	velocityX.push_back(startVelocityX);
+	velocityY.push_back(startVelocityY);
+	age.push_back(startAge);
+	rotation.push_back(startRotation);
+	type.push_back(typeId);
+	owner.push_back(ownerId);
+	ids.push_back(shotId == NO_SHOT ? handle : shotId);
+	handles.push_back(handle);
+
+	return handle;
+}
+
+int ShotStore::indexOf(ShotHandle handle) const
+{
+	uint32_t slot = handle & SHOT_INDEX_MASK;
+
+	if (handle == NO_SHOT || slot >= slotDenseIndex.size()) { return -1; }
+
+	uint32_t denseIndex = slotDenseIndex[slot];
+	if (denseIndex >= handles.size() || handles[denseIndex] != handle) { return -1; }
+
+	return (int)denseIndex;
+}
+
+bool ShotStore::remove(ShotHandle handle)
+{
+	int denseIndex = indexOf(handle);
+	if (denseIndex == -1) { return false; }
+
+	removeAt((unsigned int)denseIndex);
+	return true;
+}
+
+// Swap the last shot into the hole, so the arrays stay packed
+void ShotStore::removeAt(unsigned int denseIndex)
+{
+	uint32_t slot = handles[denseIndex] & SHOT_INDEX_MASK;
+	unsigned int last = (unsigned int)handles.size() - 1;
+
+	if (denseIndex != last)
+	{
+		x[denseIndex] = x[last];
+		y[denseIndex] = y[last];
+		velocityX[denseIndex] = velocityX[last];
+		velocityY[denseIndex] = velocityY[last];
+		age[denseIndex] = age[last];
+		rotation[denseIndex] = rotation[last];
+		type[denseIndex] = type[last];
+		owner[denseIndex] = owner[last];
+		ids[denseIndex] = ids[last];
+		handles[denseIndex] = handles[last];
+
+		slotDenseIndex[handles[denseIndex] & SHOT_INDEX_MASK] = denseIndex;
+	}
+
+	x.pop_back();
+	y.pop_back();
+	velocityX.pop_back();
+	velocityY.pop_back();
+	age.pop_back();
+	rotation.pop_back();
+	type.pop_back();
+	owner.pop_back();
+	ids.pop_back();
+	handles.pop_back();
+
+	// Bump the generation so old handles to this slot stop working
+	slotGeneration[slot] = (slotGeneration[slot] + 1) & (0xFFFFFFFF >> SHOT_INDEX_BITS);
+	freeSlots.push_back(slot);
+}
+
+void ShotStore::integrate(double elapsedSeconds)
+{
+	const unsigned int count = (unsigned int)handles.size();
+
+	// Raw restrict pointers so the compiler knows the arrays don't overlap and can vectorise each loop
+	double *__restrict px = x.data();
+	double *__restrict py = y.data();
+	double *__restrict pAge = age.data();
+	const double *__restrict pVelocityX = velocityX.data();
+	const double *__restrict pVelocityY = velocityY.data();
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		px[i] += pVelocityX[i] * elapsedSeconds;
+		py[i] += pVelocityY[i] * elapsedSeconds;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		pAge[i] += elapsedSeconds;
+	}
+}
+
+unsigned int ShotStore::expire(std::vector<ShotEvent> &events)
+{
+	unsigned int expired = 0;
+
+	// Walk backwards, so the shot swapped into a hole has already been looked at
+	for (unsigned int i = (unsigned int)handles.size(); i-- > 0; )
+	{
+		if (age[i] >= typeLifetime[type[i]])
+		{
+			ShotEvent event;
+			event.shot = handles[i];
+			event.id = ids[i];
+			event.kind = SHOT_EXPIRED;
+			event.owner = owner[i];
+			event.target = 0;
+			event.x = x[i];
+			event.y = y[i];
+			events.push_back(event);
+
+			removeAt(i);
+			expired++;
+		}
+	}
+
+	return expired;
+}
@@ -0,0 +1,111 @@
+#ifndef SHOT_STORE_H
+#define SHOT_STORE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Handle to a shot: the low SHOT_INDEX_BITS are a slot number and the rest is a generation count for that slot,
+// so a handle to a shot that has been removed never matches whatever shot ends up reusing the slot
+typedef uint32_t ShotHandle;
+
+const unsigned int SHOT_INDEX_BITS = 20;                          // Up to ~1 million live shots
+const uint32_t SHOT_INDEX_MASK = (1u << SHOT_INDEX_BITS) - 1;
+const ShotHandle NO_SHOT = 0xFFFFFFFF;
+
+// What happened to a shot that's been taken out of the store
+enum ShotEventKind
+{
+	SHOT_EXPIRED = 0,       // Ran out of time without hitting anything
+	SHOT_HIT_SHIP = 1,      // target is the interned id of the player whose ship was hit
+	SHOT_HIT_PLANET = 2     // target is the planet's index within its chunk
+};
+
+struct ShotEvent
+{
+	ShotHandle shot;        // Handle within the store it was in
+	uint32_t id;            // Id clients know it by (see ShotStore::getId)
+	uint8_t kind;           // One of ShotEventKind
+	uint32_t owner;         // Interned id of the player who fired it
+	uint32_t target;
+	double x;               // Where it happened
+	double y;
+};
+
+// Every live shot, stored as a structure of arrays. Live shots are kept packed at the front of each array (removing
+// a shot moves the last one into its place), so spawning and removing are O(1) and anything that walks all the
+// shots runs straight down contiguous memory.
+class ShotStore
+{
+private:
+	// Packed per-shot data, all indexed by the same dense index
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> velocityX;
+	std::vector<double> velocityY;
+	std::vector<double> age;              // Seconds since the shot was fired
+	std::vector<int> rotation;
+	std::vector<uint8_t> type;
+	std::vector<uint32_t> owner;          // Interned id of the player who fired it
+	std::vector<uint32_t> ids;            // Id clients know the shot by
+	std::vector<ShotHandle> handles;      // Handle of the shot at each dense index
+
+	// Slot table the handles index into
+	std::vector<uint32_t> slotDenseIndex; // Where the slot's shot lives in the packed arrays
+	std::vector<uint32_t> slotGeneration; // Bumped every time the slot is freed
+	std::vector<uint32_t> freeSlots;
+
+	// Shot types, indexed by type id
+	std::vector<std::string> typeNames;
+	std::vector<double> typeLifetime;     // Seconds a shot of this type lives for
+
+	void removeAt(unsigned int denseIndex);
+
+public:
+	// Add a kind of shot. Returns its type id
+	uint8_t registerType(const std::string &name, double lifetimeSeconds);
+
+	// Returns the type id for a name, or -1 if there's no such type
+	int findType(const std::string &name) const;
+	const std::string &getTypeName(uint8_t typeId) const { return typeNames[typeId]; }
+
+	// Add a shot, returning its handle (or NO_SHOT if the store is full). Its id is the handle unless one's given (i.e.
+	// it's come from another store, along with how old it already is)
+	ShotHandle spawn(uint8_t typeId, uint32_t ownerId, double startX, double startY, int startRotation, double startVelocityX, double startVelocityY,
+		uint32_t shotId = NO_SHOT, double startAge = 0);
+
+	// Remove a shot. Returns false if the handle is stale
+	bool remove(ShotHandle handle);
+
+	// Dense index of a shot, or -1 if the handle is stale
+	int indexOf(ShotHandle handle) const;
+
+	// Move every shot along its velocity and age it by elapsedSeconds. This is the per-tick hot loop, written as
+	// plain loops over the packed arrays with nothing in the way of the compiler vectorising it
+	void integrate(double elapsedSeconds);
+
+	// Remove any shots that have outlived their type's lifetime, adding a SHOT_EXPIRED event for each to events.
+	// Returns how many expired
+	unsigned int expire(std::vector<ShotEvent> &events);
+
+	unsigned int size() const { return (unsigned int)handles.size(); }
+
+	// Packed data for walking all the shots (valid for dense indices 0 to size() - 1)
+	double getX(unsigned int i) const { return x[i]; }
+	double getY(unsigned int i) const { return y[i]; }
+	double getVelocityX(unsigned int i) const { return velocityX[i]; }
+	double getVelocityY(unsigned int i) const { return velocityY[i]; }
+	double getAge(unsigned int i) const { return age[i]; }
+	int getRotation(unsigned int i) const { return rotation[i]; }
+	uint8_t getType(unsigned int i) const { return type[i]; }
+	uint32_t getOwner(unsigned int i) const { return owner[i]; }
+	uint32_t getId(unsigned int i) const { return ids[i]; }
+	ShotHandle getHandle(unsigned int i) const { return handles[i]; }
+
+	// The packed arrays themselves, for loops that want to run over every shot at once (i.e. collision tests)
+	const double *getXArray() const { return x.data(); }
+	const double *getYArray() const { return y.data(); }
+	const uint32_t *getOwnerArray() const { return owner.data(); }
+};
+
+#endif
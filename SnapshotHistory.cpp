@@ -0,0 +1,75 @@
+#include "SnapshotHistory.h"
+
+SnapshotHistory::SnapshotHistory()
+{
+	reset();
+}
+
+void SnapshotHistory::reset()
+{
+	for (unsigned int i = 0; i < SNAPSHOT_HISTORY; i++)
+	{
+		snapshots[i].sequence = 0;
+		snapshots[i].shotIds.clear();
+	}
+
+	lastSent = 0;
+	lastAcknowledged = 0;
+}
+
+const std::vector<uint32_t> *SnapshotHistory::getBaseline() const
+{
+	if (lastAcknowledged == 0) { return NULL; }
+
+	// The slot's been reused since they acknowledged it (they've not acknowledged anything for a while)
+	const Snapshot &snapshot = snapshots[lastAcknowledged % SNAPSHOT_HISTORY];
+	if (snapshot.sequence != lastAcknowledged) { return NULL; }
+
+	return &snapshot.shotIds;
+}
+
+uint32_t SnapshotHistory::record(std::vector<uint32_t> &shotIds)
+{
+	// 0 means "none", so skip it if we ever wrap round
+	lastSent++;
+	if (lastSent == 0) { lastSent = 1; }
+
+	Snapshot &snapshot = snapshots[lastSent % SNAPSHOT_HISTORY];
+	snapshot.sequence = lastSent;
+	snapshot.shotIds.swap(shotIds);
+
+	return lastSent;
+}
+
+bool SnapshotHistory::acknowledge(uint32_t sequence)
+{
+	if (sequence == 0 || snapshots[sequence % SNAPSHOT_HISTORY].sequence != sequence) { return false; }
+
+	// Acknowledgements can arrive out of order (i.e. over UDP), only a newer one moves the baseline on
+	if (lastAcknowledged != 0 && (int32_t)(sequence - lastAcknowledged) <= 0) { return false; }
+
+	lastAcknowledged = sequence;
+	return true;
+}
+
+void SnapshotHistory::findMissing(const std::vector<uint32_t> &visible, std::vector<unsigned int> &missing) const
+{
+	missing.clear();
+
+	const std::vector<uint32_t> *baseline = getBaseline();
+
+	if (baseline == NULL)
+	{
+		for (unsigned int i = 0; i < visible.size(); i++) { missing.push_back(i); }
+		return;
+	}
+
+	// Both are sorted, so walk them together
+	unsigned int b = 0;
+	for (unsigned int i = 0; i < visible.size(); i++)
+	{
+		while (b < baseline->size() && (*baseline)[b] < visible[i]) { b++; }
+
+		if (b == baseline->size() || (*baseline)[b] != visible[i]) { missing.push_back(i); }
+	}
+}
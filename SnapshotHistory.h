@@ -0,0 +1,53 @@
+#ifndef SNAPSHOT_HISTORY_H
+#define SNAPSHOT_HISTORY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// The last few shot snapshots sent to one client, so each new one only has to carry what they haven't got yet.
+//
+// A snapshot is the ids of every shot the client should know about once they've got it. The client acknowledges
+// snapshots as they arrive (see WIRE_MSG_SHOT_SNAPSHOT), and the next one is sent as a delta against the newest one
+// they've acknowledged: just the shots that weren't in it. Anything lost on the way is still missing from the
+// acknowledged snapshot, so it goes out again in every snapshot until one of them gets through. If they haven't
+// acknowledged anything we still have (or anything at all), everything's sent.
+const unsigned int SNAPSHOT_HISTORY = 32;
+
+class SnapshotHistory
+{
+private:
+	struct Snapshot
+	{
+		uint32_t sequence;              // 0 for a slot that's never been used
+		std::vector<uint32_t> shotIds;  // Sorted
+	};
+
+	Snapshot snapshots[SNAPSHOT_HISTORY];  // Indexed by sequence % SNAPSHOT_HISTORY
+	uint32_t lastSent;
+	uint32_t lastAcknowledged;             // 0 if they haven't acknowledged one we still have
+
+public:
+	SnapshotHistory();
+
+	// Forget everything (i.e. when a new client takes the slot)
+	void reset();
+
+	// The shots in the snapshot they last acknowledged, or NULL if we have to send everything
+	const std::vector<uint32_t> *getBaseline() const;
+
+	uint32_t getLastAcknowledged() const { return lastAcknowledged; }
+
+	// Keep a snapshot that's about to be sent, returning its sequence number. shotIds (sorted) is swapped into the
+	// history, so it comes back holding whatever was in the slot before
+	uint32_t record(std::vector<uint32_t> &shotIds);
+
+	// The client got this snapshot. Acknowledgements older than the last one (or for snapshots we never sent, or have
+	// forgotten) are ignored. Returns whether it was used
+	bool acknowledge(uint32_t sequence);
+
+	// Put the ids in visible (sorted) that aren't in the baseline into missing, by their index in visible
+	void findMissing(const std::vector<uint32_t> &visible, std::vector<unsigned int> &missing) const;
+};
+
+#endif
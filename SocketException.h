@@ -1,3 +1,6 @@
+#ifndef SOCKET_EXCEPTION_H
+#define SOCKET_EXCEPTION_H
+
 #include <string>
 
 // Custom simple exception class, we need this because to compile successfully
@@ -18,4 +21,6 @@ public:
 	{
 		return msg;
 	}
-};
\ No newline at end of file
+};
+
+#endif
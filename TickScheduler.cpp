@@ -0,0 +1,76 @@
+#include "TickScheduler.h"
+
+using namespace std::chrono;
+
+TickScheduler::TickScheduler(unsigned int ticksPerSecond, unsigned int theMaxCatchUpTicks)
+{
+	tickLength = duration_cast<Clock::duration>(duration<double>(1.0 / ticksPerSecond));
+	maxCatchUpTicks = theMaxCatchUpTicks;
+	nextTick = Clock::now() + tickLength;
+
+	resetStats();
+}
+
+int TickScheduler::millisecondsUntilNextTick() const
+{
+	Clock::duration remaining = nextTick - Clock::now();
+
+	if (remaining <= Clock::duration::zero()) { return 0; }
+
+	// Round up to a whole millisecond
+	return (int)duration_cast<milliseconds>(remaining + milliseconds(1) - Clock::duration(1)).count();
+}
+
+unsigned int TickScheduler::ticksDue()
+{
+	Clock::time_point now = Clock::now();
+
+	if (now < nextTick) { return 0; }
+
+	unsigned long long due = (unsigned long long)((now - nextTick) / tickLength) + 1;
+
+	if (due > maxCatchUpTicks)
+	{
+		// Too far behind to catch up - run what we're allowed to and start afresh from now
+		ticksSkipped += due - maxCatchUpTicks;
+		nextTick = now + tickLength;
+		return maxCatchUpTicks;
+	}
+
+	nextTick += tickLength * due;
+	return (unsigned int)due;
+}
+
+void TickScheduler::beginTick()
+{
+	tickStarted = Clock::now();
+}
+
+void TickScheduler::endTick()
+{
+	Clock::duration taken = Clock::now() - tickStarted;
+
+	ticksRun++;
+	totalTickTime += taken;
+
+	if (taken > worstTickTime) { worstTickTime = taken; }
+	if (taken > tickLength) { ticksOverrun++; }
+}
+
+void TickScheduler::printStats(std::ostream &out) const
+{
+	double averageMs = ticksRun > 0 ? duration<double, std::milli>(totalTickTime).count() / ticksRun : 0;
+
+	out << "Ticks: " << ticksRun << " run, " << ticksSkipped << " skipped, " << ticksOverrun << " overran. "
+		<< "Tick time: " << averageMs << "ms average, " << duration<double, std::milli>(worstTickTime).count() << "ms worst "
+		<< "(budget " << duration<double, std::milli>(tickLength).count() << "ms)" << std::endl;
+}
+
+void TickScheduler::resetStats()
+{
+	ticksRun = 0;
+	ticksSkipped = 0;
+	ticksOverrun = 0;
+	totalTickTime = Clock::duration::zero();
+	worstTickTime = Clock::duration::zero();
+}
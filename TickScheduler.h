@@ -0,0 +1,49 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <chrono>
+#include <ostream>
+
+// Fixed timestep scheduler. Ticks are due every 1/tickRate seconds of wall clock (steady_clock) time, regardless of
+// how long we spend waiting on the network in between. If we fall behind (i.e. a slow tick or a stall) we run the
+// missed ticks back to back, up to maxCatchUpTicks, and skip the rest rather than spiralling.
+class TickScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	Clock::duration tickLength;
+	Clock::time_point nextTick;
+	unsigned int maxCatchUpTicks;
+
+	// Timing stats, since the last call to resetStats()
+	Clock::time_point tickStarted;
+	unsigned long long ticksRun;
+	unsigned long long ticksSkipped;
+	unsigned long long ticksOverrun;       // Ticks that took longer than tickLength to run
+	Clock::duration totalTickTime;
+	Clock::duration worstTickTime;
+
+public:
+	TickScheduler(unsigned int ticksPerSecond, unsigned int theMaxCatchUpTicks);
+
+	// Seconds of simulated time in each tick
+	double getTickSeconds() const { return std::chrono::duration<double>(tickLength).count(); }
+
+	// How long we can wait (i.e. for network activity) before the next tick is due. Rounded up, so waiting this
+	// long never wakes us up early - 0 means a tick is due now
+	int millisecondsUntilNextTick() const;
+
+	// How many ticks should be run right now (0 if the next one isn't due yet). Counts as having run them
+	unsigned int ticksDue();
+
+	// Wrap each tick in these to collect timing stats
+	void beginTick();
+	void endTick();
+
+	void printStats(std::ostream &out) const;
+	void resetStats();
+};
+
+#endif
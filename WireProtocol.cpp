@@ -0,0 +1,418 @@
+#include "WireProtocol.h"
+
+// Varints carry 7 bits per byte, so a 32 bit value never needs more than 5
+static const int MAX_VARINT_BYTES = 5;
+
+// The largest count we'll believe when decoding, so a corrupt message can't make us allocate gigabytes
+static const uint32_t MAX_DECODE_COUNT = 65536;
+
+void WireWriter::writeU16(uint16_t value)
+{
+	out.push_back((char)(value >> 8));
+	out.push_back((char)(value & 0xFF));
+}
+
+void WireWriter::writeU32(uint32_t value)
+{
+	writeU16((uint16_t)(value >> 16));
+	writeU16((uint16_t)(value & 0xFFFF));
+}
+
+void WireWriter::writeU64(uint64_t value)
+{
+	writeU32((uint32_t)(value >> 32));
+	writeU32((uint32_t)(value & 0xFFFFFFFF));
+}
+
+void WireWriter::writeVarint(uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((char)((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+void WireWriter::writeSignedVarint(int32_t value)
+{
+	// Zigzag: 0, -1, 1, -2, 2... map to 0, 1, 2, 3, 4...
+	writeVarint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void WireWriter::writeString(const std::string &value)
+{
+	writeVarint((uint32_t)value.length());
+	out.append(value);
+}
+
+WireReader::WireReader(const char *theData, size_t theLength)
+{
+	data = (const uint8_t *)theData;
+	length = theLength;
+	position = 0;
+	error = false;
+}
+
+uint8_t WireReader::readU8()
+{
+	if (position >= length)
+	{
+		error = true;
+		return 0;
+	}
+	return data[position++];
+}
+
+uint16_t WireReader::readU16()
+{
+	uint16_t high = readU8();
+	uint16_t low = readU8();
+	return (uint16_t)((high << 8) | low);
+}
+
+uint32_t WireReader::readU32()
+{
+	uint32_t high = readU16();
+	uint32_t low = readU16();
+	return (high << 16) | low;
+}
+
+uint64_t WireReader::readU64()
+{
+	uint64_t high = readU32();
+	uint64_t low = readU32();
+	return (high << 32) | low;
+}
+
+uint32_t WireReader::readVarint()
+{
+	uint32_t value = 0;
+
+	for (int i = 0; i < MAX_VARINT_BYTES; i++)
+	{
+		uint8_t byte = readU8();
+		value |= (uint32_t)(byte & 0x7F) << (7 * i);
+
+		if ((byte & 0x80) == 0) { return value; }
+	}
+
+	// Too many continuation bytes
+	error = true;
+	return 0;
+}
+
+int32_t WireReader::readSignedVarint()
+{
+	uint32_t value = readVarint();
+	return (int32_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+std::string WireReader::readString()
+{
+	uint32_t stringLength = readVarint();
+
+	if (error || stringLength > length - position)
+	{
+		error = true;
+		return "";
+	}
+
+	std::string value((const char *)data + position, stringLength);
+	position += stringLength;
+	return value;
+}
+
+const char *WireReader::readBytes(size_t count)
+{
+	if (error || count > length - position)
+	{
+		error = true;
+		return NULL;
+	}
+
+	const char *start = (const char *)data + position;
+	position += count;
+	return start;
+}
+
+void encodeShot(const WireShot &shot, WireWriter &writer)
+{
+	writer.writeVarint(shot.id);
+	writer.writeVarint(shot.playerId);
+
+	if (shot.type == "blaster")
+	{
+		writer.writeU8(WIRE_SHOT_BLASTER);
+	}
+	else
+	{
+		writer.writeU8(WIRE_SHOT_NAMED);
+		writer.writeString(shot.type);
+	}
+
+	writer.writeSignedVarint(shot.x);
+	writer.writeSignedVarint(shot.y);
+	writer.writeU16(shot.rotation);
+	writer.writeSignedVarint(shot.velocityX);
+	writer.writeSignedVarint(shot.velocityY);
+	writer.writeVarint(shot.timeMs);
+}
+
+void encodeShotBatch(const std::vector<WireShot> &shots, std::string &out)
+{
+	WireWriter writer(out);
+
+	writer.writeU8(WIRE_MSG_SHOT_BATCH);
+	writer.writeVarint((uint32_t)shots.size());
+
+	for (unsigned int i = 0; i < shots.size(); i++)
+	{
+		encodeShot(shots[i], writer);
+	}
+}
+
+void encodePlayerNames(const std::vector<WirePlayerName> &names, std::string &out)
+{
+	WireWriter writer(out);
+
+	writer.writeU8(WIRE_MSG_PLAYER_NAMES);
+	writer.writeVarint((uint32_t)names.size());
+
+	for (unsigned int i = 0; i < names.size(); i++)
+	{
+		writer.writeVarint(names[i].id);
+		writer.writeString(names[i].name);
+	}
+}
+
+void encodePosition(const WirePosition &position, std::string &out)
+{
+	WireWriter writer(out);
+
+	writer.writeU8(WIRE_MSG_POSITION);
+	writer.writeVarint(position.playerId);
+	writer.writeSignedVarint(position.x);
+	writer.writeSignedVarint(position.y);
+	writer.writeSignedVarint(position.velocityX);
+	writer.writeSignedVarint(position.velocityY);
+	writer.writeU16(position.rotation);
+}
+
+void encodeShotEvents(const std::vector<WireShotEvent> &events, std::string &out)
+{
+	WireWriter writer(out);
+
+	writer.writeU8(WIRE_MSG_SHOT_EVENTS);
+	writer.writeVarint((uint32_t)events.size());
+
+	for (unsigned int i = 0; i < events.size(); i++)
+	{
+		writer.writeVarint(events[i].id);
+		writer.writeU8(events[i].kind);
+		writer.writeVarint(events[i].target);
+		writer.writeSignedVarint(events[i].x);
+		writer.writeSignedVarint(events[i].y);
+	}
+}
+
+// The count and shots that make up the rest of a shot batch or snapshot
+static bool decodeShots(WireReader &reader, std::vector<WireShot> &shots)
+{
+	uint32_t count = reader.readVarint();
+	if (count > MAX_DECODE_COUNT) { return false; }
+
+	shots.clear();
+	shots.reserve(count);
+
+	for (uint32_t i = 0; i < count && !reader.hasError(); i++)
+	{
+		WireShot shot;
+		shot.id = reader.readVarint();
+		shot.playerId = reader.readVarint();
+
+		uint8_t type = reader.readU8();
+		shot.type = (type == WIRE_SHOT_BLASTER) ? "blaster" : reader.readString();
+
+		shot.x = reader.readSignedVarint();
+		shot.y = reader.readSignedVarint();
+		shot.rotation = reader.readU16();
+		shot.velocityX = reader.readSignedVarint();
+		shot.velocityY = reader.readSignedVarint();
+		shot.timeMs = reader.readVarint();
+
+		shots.push_back(shot);
+	}
+
+	return !reader.hasError() && reader.atEnd();
+}
+
+bool decodeShotBatch(const char *data, size_t length, std::vector<WireShot> &shots)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_SHOT_BATCH) { return false; }
+
+	return decodeShots(reader, shots);
+}
+
+bool decodePlayerNames(const char *data, size_t length, std::vector<WirePlayerName> &names)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_PLAYER_NAMES) { return false; }
+
+	uint32_t count = reader.readVarint();
+	if (count > MAX_DECODE_COUNT) { return false; }
+
+	names.clear();
+
+	for (uint32_t i = 0; i < count && !reader.hasError(); i++)
+	{
+		WirePlayerName name;
+		name.id = reader.readVarint();
+		name.name = reader.readString();
+		names.push_back(name);
+	}
+
+	return !reader.hasError() && reader.atEnd();
+}
+
+bool decodePosition(const char *data, size_t length, WirePosition &position)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_POSITION) { return false; }
+
+	position.playerId = reader.readVarint();
+	position.x = reader.readSignedVarint();
+	position.y = reader.readSignedVarint();
+	position.velocityX = reader.readSignedVarint();
+	position.velocityY = reader.readSignedVarint();
+	position.rotation = reader.readU16();
+
+	return !reader.hasError() && reader.atEnd();
+}
+
+bool decodeShotEvents(const char *data, size_t length, std::vector<WireShotEvent> &events)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_SHOT_EVENTS) { return false; }
+
+	uint32_t count = reader.readVarint();
+	if (count > MAX_DECODE_COUNT) { return false; }
+
+	events.clear();
+	events.reserve(count);
+
+	for (uint32_t i = 0; i < count && !reader.hasError(); i++)
+	{
+		WireShotEvent event;
+		event.id = reader.readVarint();
+		event.kind = reader.readU8();
+		event.target = reader.readVarint();
+		event.x = reader.readSignedVarint();
+		event.y = reader.readSignedVarint();
+		events.push_back(event);
+	}
+
+	return !reader.hasError() && reader.atEnd();
+}
+
+void encodeShotSnapshot(uint32_t sequence, const std::vector<WireShot> &shots, std::string &out)
+{
+	WireWriter writer(out);
+
+	writer.writeU8(WIRE_MSG_SHOT_SNAPSHOT);
+	writer.writeVarint(sequence);
+	writer.writeVarint((uint32_t)shots.size());
+
+	for (unsigned int i = 0; i < shots.size(); i++)
+	{
+		encodeShot(shots[i], writer);
+	}
+}
+
+bool decodeShotSnapshot(const char *data, size_t length, uint32_t &sequence, std::vector<WireShot> &shots)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_SHOT_SNAPSHOT) { return false; }
+
+	sequence = reader.readVarint();
+
+	return decodeShots(reader, shots);
+}
+
+void encodeSnapshotAck(uint32_t sequence, std::string &out)
+{
+	WireWriter writer(out);
+	writer.writeU8(WIRE_MSG_SNAPSHOT_ACK);
+	writer.writeVarint(sequence);
+}
+
+bool decodeSnapshotAck(const char *data, size_t length, uint32_t &sequence)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_SNAPSHOT_ACK) { return false; }
+
+	sequence = reader.readVarint();
+
+	return !reader.hasError() && reader.atEnd();
+}
+
+void encodeUdpHello(uint64_t token, std::string &out)
+{
+	WireWriter writer(out);
+	writer.writeU8(WIRE_MSG_UDP_HELLO);
+	writer.writeU64(token);
+}
+
+bool decodeUdpHello(const char *data, size_t length, uint64_t &token)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_UDP_HELLO) { return false; }
+
+	token = reader.readU64();
+
+	return !reader.hasError() && reader.atEnd();
+}
+
+void beginUdpState(uint32_t sequence, std::string &out)
+{
+	WireWriter writer(out);
+	writer.writeU8(WIRE_MSG_UDP_STATE);
+	writer.writeU32(sequence);
+}
+
+void appendUdpMessage(const char *message, size_t length, std::string &out)
+{
+	WireWriter writer(out);
+	writer.writeVarint((uint32_t)length);
+	out.append(message, length);
+}
+
+bool decodeUdpState(const char *data, size_t length, uint32_t &sequence, std::vector<WireSlice> &messages)
+{
+	WireReader reader(data, length);
+
+	if (reader.readU8() != WIRE_MSG_UDP_STATE) { return false; }
+
+	sequence = reader.readU32();
+
+	messages.clear();
+	while (!reader.hasError() && !reader.atEnd())
+	{
+		WireSlice message;
+		message.length = reader.readVarint();
+		message.data = reader.readBytes(message.length);
+
+		if (message.data == NULL || message.length == 0) { return false; }
+		messages.push_back(message);
+	}
+
+	return !reader.hasError() && !messages.empty();
+}
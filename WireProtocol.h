@@ -0,0 +1,186 @@
+#ifndef WIRE_PROTOCOL_H
+#define WIRE_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Compact binary encoding for the high volume shot and position traffic.
+//
+// This file has no dependencies on the rest of the server (or SDL) so the client can build it as-is.
+//
+// A client asks for the binary protocol by sending "!proto:<version>~" as a text message. The server replies
+// "proto:<version>" with the version it will use (0 means stay on text), and if that's non-zero the connection
+// switches to length-prefixed framing (see MessageFramer.h) in both directions. Text messages still work as
+// before on a binary connection - a binary message is told apart by its first byte, which is always one of the
+// WIRE_MSG_ types below (control characters never start a text message).
+//
+// Integers are written as LEB128 varints, signed values zigzag encoded first so small negatives stay small.
+// Player names are sent once (WIRE_MSG_PLAYER_NAMES) and then referred to by a small interned id.
+//
+// UDP channel: a binary client with a player can also have its position and shot updates sent by UDP, where a lost
+// packet doesn't hold up everything behind it. It sends "!udp~" over TCP and gets back "udp:<port>~<token>~" (the
+// token in hex, or "udp:0~" if it can't have one), then sends WIRE_MSG_UDP_HELLO datagrams carrying the token to
+// that port until "udpok~" comes back over TCP. From then on WIRE_MSG_UDP_STATE datagrams go both ways: a sequence
+// number and one or more ordinary binary messages (positions, shot batches and snapshots, and snapshot acks). Anything older than the
+// newest sequence number already received is dropped. Everything else (player names, shot events, chunks, logins)
+// stays on TCP, so a shot batch can arrive before the name of the player who fired it.
+//
+// Shot snapshots (version 3): rather than every recent shot being sent again every tick, a version 3 client gets
+// WIRE_MSG_SHOT_SNAPSHOT, which only has the shots it hasn't acknowledged having yet. It acknowledges each one it gets
+// with "!ack:<sequence>~" over TCP or WIRE_MSG_SNAPSHOT_ACK over UDP (acknowledging a newer one covers all the older
+// ones, so lost acks don't matter). A shot keeps being sent until a snapshot with it in is acknowledged, so nothing is
+// lost for good, and the same shot can turn up in more than one snapshot - clients should ignore ids they already have.
+
+// Version 2 added WIRE_MSG_SHOT_EVENTS (version 1 clients get shot events as text instead), version 3 shot snapshots
+// (version 1 and 2 clients get WIRE_MSG_SHOT_BATCH instead)
+const uint8_t WIRE_PROTOCOL_VERSION = 3;
+
+const uint8_t WIRE_MSG_SHOT_BATCH = 0x01;    // varint count, then count shots
+const uint8_t WIRE_MSG_PLAYER_NAMES = 0x02;  // varint count, then count (varint id, varint length, name bytes)
+const uint8_t WIRE_MSG_POSITION = 0x03;      // one WirePosition
+const uint8_t WIRE_MSG_SHOT_EVENTS = 0x04;   // varint count, then count WireShotEvents (version 2 and up)
+const uint8_t WIRE_MSG_UDP_HELLO = 0x05;     // UDP only: 8 byte big-endian token
+const uint8_t WIRE_MSG_UDP_STATE = 0x06;     // UDP only: 4 byte big-endian sequence, then (varint length, message)s
+const uint8_t WIRE_MSG_SHOT_SNAPSHOT = 0x07; // varint sequence, varint count, then count shots (version 3 and up)
+const uint8_t WIRE_MSG_SNAPSHOT_ACK = 0x08;  // varint sequence of the newest snapshot received (UDP only, version 3 and up)
+
+// Largest UDP datagram we send, small enough to get through without being fragmented
+const size_t MAX_UDP_DATAGRAM = 1200;
+
+// What happened to a shot in a WireShotEvent
+const uint8_t WIRE_SHOT_EXPIRED = 0;
+const uint8_t WIRE_SHOT_HIT_SHIP = 1;         // target is the player id of the ship that was hit
+const uint8_t WIRE_SHOT_HIT_PLANET = 2;       // target is the planet's index in its chunk
+
+// Shot types we know about get a single byte, anything else is sent as WIRE_SHOT_NAMED followed by the name
+const uint8_t WIRE_SHOT_BLASTER = 0;
+const uint8_t WIRE_SHOT_NAMED = 0xFF;
+
+// True if a received frame is a binary message rather than a text one
+inline bool isBinaryMessage(const char *frame, int length)
+{
+	return length > 0 && (uint8_t)frame[0] < 0x20;
+}
+
+struct WireShot
+{
+	uint32_t id;            // Unique id of the shot
+	uint32_t playerId;      // Interned id of the player who fired it
+	std::string type;       // i.e. "blaster"
+	int32_t x;
+	int32_t y;
+	uint16_t rotation;      // Degrees
+	int32_t velocityX;
+	int32_t velocityY;
+	uint32_t timeMs;        // How long the shot has been alive
+};
+
+struct WirePosition
+{
+	uint32_t playerId;
+	int32_t x;
+	int32_t y;
+	int32_t velocityX;
+	int32_t velocityY;
+	uint16_t rotation;
+};
+
+struct WireShotEvent
+{
+	uint32_t id;            // Id of the shot, as sent in WIRE_MSG_SHOT_BATCH
+	uint8_t kind;           // One of the WIRE_SHOT_ event kinds
+	uint32_t target;
+	int32_t x;              // Where it happened
+	int32_t y;
+};
+
+struct WirePlayerName
+{
+	uint32_t id;
+	std::string name;
+};
+
+// A message inside a WIRE_MSG_UDP_STATE datagram (pointing into the datagram)
+struct WireSlice
+{
+	const char *data;
+	size_t length;
+};
+
+// Whether UDP sequence number a comes after b (allowing for them wrapping round)
+inline bool isNewerSequence(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) > 0;
+}
+
+// Appends encoded values to a string
+class WireWriter
+{
+private:
+	std::string &out;
+
+public:
+	WireWriter(std::string &theOut) : out(theOut) {}
+
+	void writeU8(uint8_t value) { out.push_back((char)value); }
+	void writeU16(uint16_t value);      // Fixed width, big-endian
+	void writeU32(uint32_t value);
+	void writeU64(uint64_t value);
+	void writeVarint(uint32_t value);
+	void writeSignedVarint(int32_t value);
+	void writeString(const std::string &value);
+};
+
+// Reads encoded values from a buffer. Reading past the end sets the error flag and returns zeros
+class WireReader
+{
+private:
+	const uint8_t *data;
+	size_t length;
+	size_t position;
+	bool error;
+
+public:
+	WireReader(const char *theData, size_t theLength);
+
+	uint8_t readU8();
+	uint16_t readU16();
+	uint32_t readU32();
+	uint64_t readU64();
+	uint32_t readVarint();
+	int32_t readSignedVarint();
+	std::string readString();
+
+	// Skip count bytes, returning where they start (NULL if there aren't that many left)
+	const char *readBytes(size_t count);
+
+	bool hasError() { return error; }
+	bool atEnd() { return position == length; }
+};
+
+// Encoders append a complete binary message to out
+void encodeShotBatch(const std::vector<WireShot> &shots, std::string &out);
+void encodeShot(const WireShot &shot, WireWriter &writer);
+void encodePlayerNames(const std::vector<WirePlayerName> &names, std::string &out);
+void encodePosition(const WirePosition &position, std::string &out);
+void encodeShotEvents(const std::vector<WireShotEvent> &events, std::string &out);
+void encodeShotSnapshot(uint32_t sequence, const std::vector<WireShot> &shots, std::string &out);
+void encodeSnapshotAck(uint32_t sequence, std::string &out);
+
+// Decoders return false if the message is malformed (or isn't the type asked for)
+bool decodeShotBatch(const char *data, size_t length, std::vector<WireShot> &shots);
+bool decodePlayerNames(const char *data, size_t length, std::vector<WirePlayerName> &names);
+bool decodePosition(const char *data, size_t length, WirePosition &position);
+bool decodeShotEvents(const char *data, size_t length, std::vector<WireShotEvent> &events);
+bool decodeShotSnapshot(const char *data, size_t length, uint32_t &sequence, std::vector<WireShot> &shots);
+bool decodeSnapshotAck(const char *data, size_t length, uint32_t &sequence);
+
+// UDP datagrams. A state datagram is started with beginUdpState and then has messages appended until it's full
+void encodeUdpHello(uint64_t token, std::string &out);
+bool decodeUdpHello(const char *data, size_t length, uint64_t &token);
+void beginUdpState(uint32_t sequence, std::string &out);
+void appendUdpMessage(const char *message, size_t length, std::string &out);
+bool decodeUdpState(const char *data, size_t length, uint32_t &sequence, std::vector<WireSlice> &messages);
+
+#endif
@@ -0,0 +1,104 @@
+#include "WorkerGroup.h"
+
+using namespace std;
+
+WorkerGroup::WorkerGroup()
+{
+	job = NULL;
+	jobCount = 0;
+	nextJob = 0;
+	busy = 0;
+	runNumber = 0;
+	stopping = false;
+}
+
+WorkerGroup::~WorkerGroup()
+{
+	stop();
+}
+
+void WorkerGroup::start(unsigned int numWorkers)
+{
+	stopping = false;
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(thread(&WorkerGroup::workerLoop, this));
+	}
+}
+
+void WorkerGroup::stop()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	workReady.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+}
+
+void WorkerGroup::workerLoop()
+{
+	uint64_t lastRun = 0;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			workReady.wait(guard, [this, lastRun] { return stopping || runNumber != lastRun; });
+
+			if (stopping) { return; }
+
+			lastRun = runNumber;
+		}
+
+		runJobs();
+
+		{
+			lock_guard<mutex> guard(lock);
+			busy--;
+			if (busy == 0) { workDone.notify_one(); }
+		}
+	}
+}
+
+// Take jobs until there are none left
+void WorkerGroup::runJobs()
+{
+	for (unsigned int i = nextJob.fetch_add(1); i < jobCount; i = nextJob.fetch_add(1))
+	{
+		(*job)(i);
+	}
+}
+
+void WorkerGroup::run(unsigned int count, const std::function<void(unsigned int)> &theJob)
+{
+	// Not worth waking anyone for one job
+	if (workers.empty() || count <= 1)
+	{
+		for (unsigned int i = 0; i < count; i++) { theJob(i); }
+		return;
+	}
+
+	{
+		lock_guard<mutex> guard(lock);
+		job = &theJob;
+		jobCount = count;
+		nextJob = 0;
+		busy = (unsigned int)workers.size();
+		runNumber++;
+	}
+	workReady.notify_all();
+
+	// Help out rather than just waiting
+	runJobs();
+
+	unique_lock<mutex> guard(lock);
+	workDone.wait(guard, [this] { return busy == 0; });
+	job = NULL;
+}
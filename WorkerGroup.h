@@ -0,0 +1,48 @@
+#ifndef WORKER_GROUP_H
+#define WORKER_GROUP_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+// A fixed set of threads for splitting one job across cores and waiting for all of it, i.e. once a tick: run(count, job)
+// calls job(0) to job(count - 1), spread over the worker threads and the calling thread, and only returns once every
+// one has finished. The workers sleep between runs.
+//
+// Jobs are handed out one at a time as threads come free, so a few slow ones don't hold the others up.
+class WorkerGroup
+{
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex lock;                        // Guards everything below apart from nextJob
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	const std::function<void(unsigned int)> *job;
+	unsigned int jobCount;
+	std::atomic<unsigned int> nextJob;      // Next job number to hand out
+	unsigned int busy;                      // Workers that haven't finished with this run yet
+	uint64_t runNumber;                     // Bumped for every run, which is what wakes the workers
+	bool stopping;
+
+	void workerLoop();
+	void runJobs();
+
+public:
+	WorkerGroup();
+	~WorkerGroup();
+
+	// With no workers, run() does everything on the calling thread
+	void start(unsigned int numWorkers);
+	void stop();
+	unsigned int size() const { return (unsigned int)workers.size(); }
+
+	// Call theJob for 0 to count - 1, waiting until they're all done. Only call from one thread at a time
+	void run(unsigned int count, const std::function<void(unsigned int)> &theJob);
+};
+
+#endif
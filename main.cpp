@@ -7,59 +7,82 @@
 #include "string"
 #include "SDL_net.h"
 #include "ServerSocket.h"
+#include "Benchmarks.h"
+#include "ServerConfig.h"
+#include "TickScheduler.h"
+#include "RegionFile.h"
 #include <fstream>
 #include <chrono>
-#include <ctime>
 #include <cstdlib>
 
 // Create a pointer to a ServerSocket object
 ServerSocket *ss;
 
-///////////////////// time stuff //////////////////
+///////////////////// tick stuff //////////////////
 
+// Server settings (see data/server.cfg)
+ServerConfig config;
 
-double holdTime = 0;
-double currentTime = 0;
-double duration = 0;
+// Number of ticks run so far, used for things that happen every so many ticks
+unsigned long long tickCounter = 0;
 
-void updateTimeStuff() {
+//everything that happens once per simulation tick
+void runTick(double tickSeconds) {
 
-	//get time passed
-	currentTime = std::clock() / (double)CLOCKS_PER_SEC;
-	duration = currentTime - holdTime;
-	//setting time passed back to zero every (1) second
-	//0.02
+	//send shots and then delete any shots that have expired
+	ss->updateShooting2(tickSeconds);
 
-	if (duration >= 0.16 ){
+	//telling everyone about players that have left
+	ss->broadcastSessionEvents();
 
-		holdTime = std::clock() / (double)CLOCKS_PER_SEC;
+	//sending players connected to server (once a second), and letting go of planets that aren't needed any more
+	if (tickCounter % config.tickRate == 0) {
+		ss->forgetUnusedPlanets();
 
-		////// every frame stuff goes here ///////
-		
-		//send shot and then delte shot
-		ss->updateShooting2();
-
-	}
-	else if (duration > 0.02 && duration < 0.03) {
-		ss->updateShooting();
-	}
-	else if (duration > 0.07 && duration < 0.08) {
-		ss->updateShooting();
-	}
-	else if (duration > 0.12 && duration < 0.13) {
-		ss->updateShooting();
+		string playerMessage = "players:";
+		playerMessage += std::to_string(ss->getClientCount());
+		ss->sendToClients(playerMessage);
 	}
 
+	tickCounter++;
 }
 
-//////////////////// end time stuff //////////////////
+//////////////////// end tick stuff //////////////////
 
 
 int main(int argc, char *argv[])
 {
 
-	//sending players connected every once and a while
-	int playerCounter = 0;
+	// Run a benchmark instead of the server if asked to (see Benchmarks.h)
+	if (argc > 1 && string(argv[1]) == "--bench-parser")
+	{
+		return runParserBenchmark(argc > 2 ? argv[2] : NULL);
+	}
+	if (argc > 1 && string(argv[1]) == "--bench-shots")
+	{
+		return runShotBenchmark(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atoi(argv[3]) : 0);
+	}
+	if (argc > 1 && string(argv[1]) == "--bench-chunks")
+	{
+		return runChunkBenchmark(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atoi(argv[3]) : -1);
+	}
+	if (argc > 1 && string(argv[1]) == "--bench-login")
+	{
+		return runLoginBenchmark(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atoi(argv[3]) : 0);
+	}
+	if (argc > 1 && string(argv[1]) == "--bench-accept")
+	{
+		return runAcceptBenchmark(argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atoi(argv[3]) : 0);
+	}
+
+	// Pack the old one-file-per-chunk saves into region files (see RegionFile.h), then exit
+	if (argc > 1 && string(argv[1]) == "--convert-chunks")
+	{
+		return convertChunkFiles(argc > 2 ? argv[2] : "data/chunks", argc > 3 ? argv[3] : "data/regions");
+	}
+
+	// Read the server settings, sticking with the defaults if there's no settings file
+	config.load("data/server.cfg");
 
 	// Initialise SDL_net
 	if (SDLNet_Init() == -1)
@@ -72,12 +95,28 @@ int main(int argc, char *argv[])
 	{
 		// Not try to instantiate the server socket
 		// Parameters: port number, buffer size (i.e. max message size), max sockets
-		int port;
-		cout << "Enter local port:";
-		std::cin >> port;
-
-
-		ss = new ServerSocket(port, 512, 100);
+		int port = config.port;
+		if (port == 0) {
+			cout << "Enter local port:";
+			std::cin >> port;
+		}
+
+
+		// One socket for each client, plus the listening socket
+		ss = new ServerSocket(port, 512, config.maxClients + 1);
+		if (!ss->startAcceptors(config.acceptorThreads)) {
+			std::cerr << "Acceptor threads aren't supported on this platform, accepting on the network thread" << std::endl;
+		}
+		if (config.udpChannels != 0 && !ss->openUdpChannels()) {
+			std::cerr << "Couldn't open the UDP socket, clients will only have TCP" << std::endl;
+		}
+		ss->setChunkCacheSize(config.chunkCacheSize);
+		ss->setWorldSeed(config.worldSeed);
+		ss->setPlanetLayout(config.planetsPerChunk, config.planetSpacing);
+		ss->setChunkPrefetch(config.prefetchChunks != 0, config.prefetchSeconds, config.pushChunks != 0);
+		ss->startChunkWorkers(config.chunkWorkers);
+		ss->startSimulationThreads(config.simulationThreads);
+		ss->startPasswordWorkers(config.passwordWorkers, config.passwordCost);
 	}
 	catch (SocketException e)
 	{
@@ -89,50 +128,22 @@ int main(int argc, char *argv[])
 
 	try
 	{
+		// Ticks happen at a fixed rate, and in between we sleep until either the next tick is due or a socket has activity
+		TickScheduler scheduler(config.tickRate, config.maxCatchUpTicks);
+		std::chrono::steady_clock::time_point lastStats = std::chrono::steady_clock::now();
+
 		// Specify which client is active, -1 means "no client is active"
 		int activeClient = -1;
 
 		// Main loop...
 		do
 		{
-			//check for time sensitive activities
-			if (playerCounter % 3) {
-				updateTimeStuff();
-			}
-
-			// Check for any incoming connections to the server socket
-			ss->checkForConnections();
+			// Wait for network activity (or until the next tick is due) and accept any incoming connections to the server socket
+			ss->checkForConnections(scheduler.millisecondsUntilNextTick());
 
 			// At least once, but as many times as necessary to process all active clients...
 			do
-			{	
-
-				if (playerCounter == 500) {
-					if (ss->getLeavePlayer1() != "") {
-						ss->sendToClients("usrl:" + ss->getLeavePlayer1());
-						cout << ss->getLeavePlayer1() << " left the game." << endl;
-						ss->setplayerLeaving1();
-					}
-				}
-				if (playerCounter == 502) {
-					if (ss->getLeavePlayer2() != "") {
-						ss->sendToClients("usrl:" + ss->getLeavePlayer2());
-						cout << ss->getLeavePlayer2() << " left the game." << endl;
-						ss->setplayerLeaving2();
-					}
-				}
-				//sending players connected to server
-				if (playerCounter > 1000) {
-					string playerMessage = "players:";
-					playerMessage += std::to_string(ss->getClientCount());
-					ss->sendToClients(playerMessage);
-					playerCounter = 0;
-				}
-				else {
-					
-					playerCounter++;
-				}
-
+			{
 				// ..get the client number of any clients with unprocessed activity (returns -1 if none)
 				activeClient = ss->checkForActivity();
 
@@ -147,6 +158,38 @@ int main(int argc, char *argv[])
 				// When there are no more clients with activity to process, continue...
 			} while (activeClient != -1);
 
+			// Send out any chunks (and answer any logins) the workers have finished with since we last looked
+			ss->collectLoadedChunks();
+			ss->collectPasswordResults();
+
+			// Run any ticks that are due (more than one if we've fallen behind)
+			unsigned int ticksDue = scheduler.ticksDue();
+			for (unsigned int tick = 0; tick < ticksDue; tick++)
+			{
+				scheduler.beginTick();
+				runTick(scheduler.getTickSeconds());
+				scheduler.endTick();
+			}
+
+			// Send everything the tick (and the messages handled since the last one) produced, one send per client
+			if (ticksDue > 0)
+			{
+				ss->flushClients();
+			}
+
+			// Report how long ticks are taking (and how the chunk cache is doing), if asked to
+			if (config.statsInterval > 0 && std::chrono::steady_clock::now() - lastStats >= std::chrono::seconds(config.statsInterval))
+			{
+				scheduler.printStats(cout);
+				scheduler.resetStats();
+				ss->printSessionStats(cout);
+				ss->getChunkCache().printStats(cout);
+				ss->getChunkCache().resetStats();
+				ss->getChunkLoader().printStats(cout);
+				ss->getChunkLoader().resetStats();
+				lastStats = std::chrono::steady_clock::now();
+			}
+
 			// ...until we've been asked to shut down.
 		} while (ss->getShutdownStatus() == false);
 